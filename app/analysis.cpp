@@ -0,0 +1,85 @@
+#include "analysis.hpp"
+#include <memory>
+
+// free the copy of a position taken for the analysis
+void dispose(Position* pos) {
+  if (!pos) return;
+  clearPosition(*pos);
+  delete pos;
+}
+
+Analyzer::Analyzer(TranspositionTable& tt, int threads)
+  : tt{tt}, threads{threads} {
+  worker = thread(&Analyzer::work, this);
+}
+
+Analyzer::~Analyzer() {
+  quit = true;
+  interrupt = true;
+  signal.fetch_add(1, memory_order_release);
+  signal.notify_one();
+  worker.join();
+  Position* pos;
+  while (snapshots.pop(pos)) dispose(pos);
+}
+
+// stop the current search and analyze a copy of the position instead
+void Analyzer::analyze(const Position& pos) {
+  Position* snapshot = new Position(0);
+  copyPosition(*snapshot, pos);
+  // the worker empties the queue as soon as it is interrupted
+  while (!snapshots.push(snapshot)) this_thread::yield();
+  interrupt = true;
+  signal.fetch_add(1, memory_order_release);
+  signal.notify_one();
+}
+
+// stop the current search and wait for the next position
+void Analyzer::stop() {
+  while (!snapshots.push(nullptr)) this_thread::yield();
+  interrupt = true;
+  signal.fetch_add(1, memory_order_release);
+  signal.notify_one();
+}
+
+// search the incoming positions until the analyzer is destroyed
+void Analyzer::work() {
+  Position* current = nullptr;
+  bool done = true;
+  uint32_t seen = 0;
+  while (true) {
+    // sleep until a position arrives, unless the last one is unfinished
+    if (done) signal.wait(seen, memory_order_acquire);
+    seen = signal.load(memory_order_acquire);
+    if (quit) break;
+    // only the newest position is worth searching; a position which
+    // arrives after the interrupt was cleared interrupts again
+    interrupt = false;
+    Position* next;
+    while (snapshots.pop(next)) {
+      dispose(current);
+      current = next;
+      done = !next;
+    }
+    if (done || !current) continue;
+
+    auto search = make_unique<Search>(*current, &tt);
+    search->threads = threads;
+    search->abort = &interrupt;
+    search->report = [&](const SearchResult& result) {
+      AnalysisInfo& info = results.back();
+      info.key = current->key;
+      info.score = current->player ? result.score : -result.score;
+      info.depth = result.depth;
+      info.nodes = result.nodes;
+      info.pvLength = int(result.pv.size());
+      for (int i = 0; i < info.pvLength; i++) info.pv[i] = result.pv[i];
+      results.publish();
+    };
+    SearchLimits limits;
+    search->run(limits);
+    // an interrupted search is resumed if no newer position came in
+    done = !interrupt;
+  }
+  dispose(current);
+}
@@ -0,0 +1,97 @@
+#include "display.hpp"
+#include "search.hpp"
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace chrono;
+
+// positions searched by the benchmark, from the opening to the endgame
+const vector<string> benchFENs = {
+  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+  "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+  "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8",
+  "r2q1rk1/1b2bppp/p2ppn2/1p6/3NP3/1BN1B3/PPP1QPPP/R4RK1 w - - 0 12",
+  "2r2rk1/pp3ppp/2n1b3/3pP3/3P4/2PB1N2/P4PPP/R4RK1 b - - 3 17",
+  "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+  "6k1/5pp1/4p2p/3pP3/1r1P4/5PP1/R5KP/8 w - - 0 35",
+  "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1",
+};
+
+// print usage information
+void usage() {
+  cout << "usage: thinkchess-bench [options] [depth]\n"
+       << "  --threads N  measure 1, 2, 4 ... up to N threads\n"
+       << "  --hash MB    size of the transposition table\n"
+       << "  --net FILE   evaluate with the network in FILE\n";
+}
+
+int main(int argc, char* argv[]) {
+  initBitboards();
+
+  int maxThreads = int(thread::hardware_concurrency());
+  int hashMB = 64;
+  int depth = 7;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      maxThreads = atoi(argv[++i]);
+    } else if (arg == "--hash" && i + 1 < argc) {
+      hashMB = atoi(argv[++i]);
+    } else if (arg == "--net" && i + 1 < argc) {
+      if (!loadNetwork(argv[++i])) {
+        cout << "cannot load network " << argv[i] << "\n";
+        return 1;
+      }
+      cout << "network loaded, " << nnueKernel() << " kernels\n";
+    } else if (isdigit(arg[0])) {
+      depth = atoi(arg.c_str());
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  maxThreads = max(1, maxThreads);
+
+  // thread counts to measure, doubling up to the maximum
+  vector<int> counts;
+  for (int n = 1; n < maxThreads; n *= 2) counts.push_back(n);
+  counts.push_back(maxThreads);
+
+  // the same depth is searched with every thread count, so the speedup
+  // is the time to reach the depth compared with one thread
+  TranspositionTable tt;
+  tt.resize(hashMB);
+  double baseTime = 0;
+  cout << "threads      time s       nodes         nps  speedup   ebf\n";
+  for (int threads : counts) {
+    uint64_t nodes = 0;
+    double seconds = 0;
+    double branching = 0;
+    for (const auto& fen : benchFENs) {
+      Position pos(0);
+      setBoard(pos, fen);
+      tt.clear(threads);
+      SearchLimits limits;
+      limits.depth = depth;
+      auto start = steady_clock::now();
+      SearchResult result = search(pos, limits, &tt, threads);
+      seconds += duration<double>(steady_clock::now() - start).count();
+      nodes += result.nodes;
+      branching += result.branching;
+      clearPosition(pos);
+    }
+    if (threads == 1) baseTime = seconds;
+    cout << setw(7) << threads << fixed << setprecision(3)
+         << setw(12) << seconds << setw(12) << nodes
+         << setw(12) << uint64_t(seconds > 0 ? nodes / seconds : 0)
+         << setprecision(2) << setw(9) << baseTime / seconds
+         << setw(6) << branching / benchFENs.size() << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,169 @@
+#include "bitboard.hpp"
+#include "evaluate.hpp"
+#include "pieces.hpp"
+#include "zobrist.hpp"
+
+using namespace std;
+
+Magic rookMagics[64];
+Magic bishopMagics[64];
+Bitboard knightAttacks[64];
+Bitboard kingAttacks[64];
+Bitboard pawnAttacks[2][64];
+Bitboard betweenBB[64][64];
+Bitboard lineBB[64][64];
+
+// attack sets of all squares and occupancies, shared by the magics
+Bitboard rookTable[0x19000];
+Bitboard bishopTable[0x1480];
+
+// walk the rays in the given directions until the board edge or a blocker
+Bitboard slidingAttacks(int sq, Bitboard occupied, const int (*dirs)[2]) {
+  Bitboard attacks = 0;
+  for (int d = 0; d < 4; d++) {
+    int row = squareRow(sq) + dirs[d][0];
+    int col = squareCol(sq) + dirs[d][1];
+    while (row >= 0 && row < 8 && col >= 0 && col < 8) {
+      int s = toSquare(row, col);
+      attacks |= squareBB(s);
+      if (occupied & squareBB(s)) break;
+      row += dirs[d][0];
+      col += dirs[d][1];
+    }
+  }
+  return attacks;
+}
+
+// squares reached by single steps in the given directions
+Bitboard leaperAttacks(int sq, const int (*steps)[2], int n) {
+  Bitboard attacks = 0;
+  for (int i = 0; i < n; i++) {
+    int row = squareRow(sq) + steps[i][0];
+    int col = squareCol(sq) + steps[i][1];
+    if (row >= 0 && row < 8 && col >= 0 && col < 8) {
+      attacks |= squareBB(toSquare(row, col));
+    }
+  }
+  return attacks;
+}
+
+// pseudo random numbers with few set bits, good candidates for magics
+Bitboard sparseRandom(Bitboard& seed) {
+  Bitboard r = ~Bitboard(0);
+  for (int i = 0; i < 3; i++) {
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    r &= seed * 2685821657736338717ULL;
+  }
+  return r;
+}
+
+// fill the magics and the attack table for one kind of slider
+void initMagics(Magic magics[], Bitboard table[], const int (*dirs)[2]) {
+  Bitboard occupancy[4096];
+  Bitboard reference[4096];
+  Bitboard* attacks = table;
+#ifndef USE_PEXT
+  int epoch[4096] = {};
+  int count = 0;
+  // seeds per rank, known to find magics quickly
+  const Bitboard seeds[8] = {728, 10316, 55123, 32803, 12281, 15100, 16645, 255};
+#endif
+
+  for (int sq = 0; sq < 64; sq++) {
+    // board edges are not relevant for the attacks, unless on the same line
+    Bitboard rank1 = 0xFFULL;
+    Bitboard rank8 = rank1 << 56;
+    Bitboard fileA = 0x0101010101010101ULL;
+    Bitboard fileH = fileA << 7;
+    Bitboard rank = rank1 << (8 * (sq / 8));
+    Bitboard file = fileA << (sq % 8);
+    Bitboard edges = ((rank1 | rank8) & ~rank) | ((fileA | fileH) & ~file);
+
+    Magic& m = magics[sq];
+    m.mask = slidingAttacks(sq, 0, dirs) & ~edges;
+    m.shift = 64 - popCount(m.mask);
+    m.attacks = attacks;
+
+    // enumerate all subsets of the mask (carry-rippler)
+    int size = 0;
+    Bitboard b = 0;
+    do {
+      occupancy[size] = b;
+      reference[size] = slidingAttacks(sq, b, dirs);
+      size++;
+      b = (b - m.mask) & m.mask;
+    } while (b);
+    attacks += size;
+
+#ifdef USE_PEXT
+    for (int i = 0; i < size; i++) {
+      m.attacks[m.index(occupancy[i])] = reference[i];
+    }
+#else
+    // search a magic which maps all occupancies without harmful collisions
+    Bitboard seed = seeds[sq / 8];
+    for (int i = 0; i < size; ) {
+      m.magic = 0;
+      while (popCount((m.magic * m.mask) >> 56) < 6) {
+        m.magic = sparseRandom(seed);
+      }
+      count++;
+      for (i = 0; i < size; i++) {
+        unsigned idx = m.index(occupancy[i]);
+        if (epoch[idx] < count) {
+          epoch[idx] = count;
+          m.attacks[idx] = reference[i];
+        } else if (m.attacks[idx] != reference[i]) {
+          break;
+        }
+      }
+    }
+#endif
+  }
+}
+
+// build the attack tables, hash keys and piece square tables,
+// has to be called once at startup
+void initBitboards() {
+  initZobrist();
+  initEvaluation();
+
+  const int rookDirs[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+  const int bishopDirs[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+  initMagics(rookMagics, rookTable, rookDirs);
+  initMagics(bishopMagics, bishopTable, bishopDirs);
+
+  const int knightSteps[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2},
+                                 {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+  const int kingSteps[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1},
+                               {0, 1}, {1, -1}, {1, 0}, {1, 1}};
+  const int whitePawnSteps[2][2] = {{-1, -1}, {-1, 1}};
+  const int blackPawnSteps[2][2] = {{1, -1}, {1, 1}};
+  for (int sq = 0; sq < 64; sq++) {
+    knightAttacks[sq] = leaperAttacks(sq, knightSteps, 8);
+    kingAttacks[sq] = leaperAttacks(sq, kingSteps, 8);
+    pawnAttacks[WHITE][sq] = leaperAttacks(sq, whitePawnSteps, 2);
+    pawnAttacks[BLACK][sq] = leaperAttacks(sq, blackPawnSteps, 2);
+  }
+
+  for (int s1 = 0; s1 < 64; s1++) {
+    for (int s2 = 0; s2 < 64; s2++) {
+      betweenBB[s1][s2] = 0;
+      lineBB[s1][s2] = 0;
+      if (s1 == s2) continue;
+      if (rookAttacks(s1, 0) & squareBB(s2)) {
+        betweenBB[s1][s2] = rookAttacks(s1, squareBB(s2))
+                          & rookAttacks(s2, squareBB(s1));
+        lineBB[s1][s2] = (rookAttacks(s1, 0) & rookAttacks(s2, 0))
+                       | squareBB(s1) | squareBB(s2);
+      } else if (bishopAttacks(s1, 0) & squareBB(s2)) {
+        betweenBB[s1][s2] = bishopAttacks(s1, squareBB(s2))
+                          & bishopAttacks(s2, squareBB(s1));
+        lineBB[s1][s2] = (bishopAttacks(s1, 0) & bishopAttacks(s2, 0))
+                       | squareBB(s1) | squareBB(s2);
+      }
+    }
+  }
+}
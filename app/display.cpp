@@ -1,19 +1,87 @@
 #include "display.hpp"
+#include "evaluate.hpp"
+#include "movegen.hpp"
 
 using namespace std;
 
-// get path for game to load
-filesystem::path getGame(int fn, filesystem::path games) {
-  int cnt = 0;
-  filesystem::path p;
-  for (auto const& file : filesystem::directory_iterator{games}) {
-    if (cnt == fn) {
-      p = file.path();
-      break;
+// read game n of a store, fails if its record, start position or one of its
+// moves is damaged
+bool readStoredGame(const GameStore& store, uint64_t n, PgnGame& game) {
+  if (!store.read(n, game)) return false;
+  Position pos(0);
+  bool legal = pos.fromFEN(game.fen.empty() ? START_FEN : string_view(game.fen));
+  for (size_t i = 0; i < game.moves.size() && legal; i++) {
+    legal = isLegal(pos, game.moves[i]);
+    if (legal) pos.doMove(game.moves[i]);
+  }
+  clearPosition(pos);
+  return legal;
+}
+
+// list a page of the games of a store for the game loader
+string listGames(const GameStore& store, uint64_t page) {
+  if (store.size() == 0) return "no games stored";
+  string list;
+  uint64_t first = page * GAMES_PER_PAGE;
+  uint64_t last = min<uint64_t>(first + GAMES_PER_PAGE, store.size());
+  PgnGame game;
+  for (uint64_t n = first; n < last; n++) {
+    list.append(1, '<');
+    list += to_string(n - first);
+    list += "> ";
+    GameInfo info;
+    if (store.info(n, info) && readStoredGame(store, n, game)) {
+      // names are cut to fit the loader
+      list += info.white.substr(0, 6);
+      list.append(1, '-');
+      list += info.black.substr(0, 6);
+      list.append(1, ' ');
+      list += gameResults[info.result];
+    } else {
+      list += "damaged game";
+    }
+    list += "\n";
+  }
+  list.append(1, '\n');
+  list += to_string(first + 1);
+  list.append(1, '-');
+  list += to_string(last);
+  list += " of ";
+  list += to_string(store.size());
+  list += "\n<Up> <Down> page";
+  return list;
+}
+
+// make a move of a stored game and mark check and mate for the display
+void playStoredMove(Position& pos, Move move) {
+  pos.doMove(move);
+  pos.checked = pos.checkers;
+  if (pos.checkers) {
+    MoveList list;
+    generateLegalMoves(pos, list);
+    if (list.size == 0) pos.checkmate = {squareRow(moveTo(move)), squareCol(moveTo(move))};
+  }
+}
+
+// moves history of a stored game, in the format of the game files
+string gameHistory(const PgnGame& game) {
+  string history;
+  Position pos(0);
+  if (!pos.fromFEN(game.fen.empty() ? START_FEN : string_view(game.fen))) return history;
+  for (auto move : game.moves) {
+    playStoredMove(pos, move);
+    if (pos.mvCount % 2 == 1) {
+      history += to_string(pos.mvCount / 2 + 1);
+      history += ". ";
+      history += pos.lastMove();
+      history.append(1, ' ');
+    } else {
+      history += pos.lastMove();
+      history.append(1, '\n');
     }
-    cnt++;
   }
-  return p;
+  clearPosition(pos);
+  return history;
 }
 
 // calculates and returns the timer string
@@ -54,65 +122,38 @@ void setValidMoves(const Position& pos,
                    vector<vector<short>>& vm,
                    pair<int, int> field)
 {
-  auto pc = pos.board[field.first][field.second];
+  auto pc = pos.pieceAt(field.first, field.second);
   if (!pc) return;
-  for (int row = 0; row < 8; row++) {
-    for (int col = 0; col < 8; col++) {
-      if (pc->isValid(pos.board, row, col)) {
-        auto current = pos.board[row][col];
-        if (!current) vm[row][col] = 1;
-        else if (pc->isWhite() != current->isWhite()) vm[row][col] = 2;
-      }
-    }
+  int from = toSquare(field.first, field.second);
+  MoveList list;
+  if (pc->isWhite() == pos.player) {
+    generateLegalMoves(pos, list);
+  } else { // show the moves of the opponent as well
+    Position opponent(0);
+    copyPosition(opponent, pos);
+    // checkers and en passant square belong to the player on turn
+    opponent.player = !pos.player;
+    opponent.epSquare = NO_SQUARE;
+    opponent.updateCheckers();
+    generateLegalMoves(opponent, list);
+    clearPosition(opponent);
+  }
+  for (auto move : list) {
+    if (moveFrom(move) != from) continue;
+    int row = squareRow(moveTo(move));
+    int col = squareCol(moveTo(move));
+    // 1 = move, 2 = capture, 3 = capture which loses material
+    if (!isCapture(move)) vm[row][col] = 1;
+    else vm[row][col] = see(pos, move) < 0 ? 3 : 2;
   }
 }
 
 // reset board for new game
 void resetBoard(Position& pos) {
-  // reset moves and captured pieces
-  pos.moves.clear();
-  pos.captured.clear();
-  // reset board
-  for (int row = 0; row < 8; row++) {
-    for (int col = 0; col < 8; col++) {
-      pos.board[row][col] = nullptr;
-    }
-  }
-  // set board to initial position
-  // rank 8 (black)
-  pos.board[0][0] = new Rook(0,0,0);
-  pos.board[0][1] = new Knight(0,0,1);
-  pos.board[0][2] = new Bishop(0,0,2);
-  pos.board[0][3] = new Queen(0,0,3);
-  pos.board[0][4] = new King(0,0,4);
-  pos.board[0][5] = new Bishop(0,0,5);
-  pos.board[0][6] = new Knight(0,0,6);
-  pos.board[0][7] = new Rook(0,0,7);
-  // rank 7 (black)
-  pos.board[1][0] = new Pawn(0,1,0);
-  pos.board[1][1] = new Pawn(0,1,1);
-  pos.board[1][2] = new Pawn(0,1,2);
-  pos.board[1][3] = new Pawn(0,1,3);
-  pos.board[1][4] = new Pawn(0,1,4);
-  pos.board[1][5] = new Pawn(0,1,5);
-  pos.board[1][6] = new Pawn(0,1,6);
-  pos.board[1][7] = new Pawn(0,1,7);
-  // rank 2 (white)
-  pos.board[6][0] = new Pawn(1,6,0);
-  pos.board[6][1] = new Pawn(1,6,1);
-  pos.board[6][2] = new Pawn(1,6,2);
-  pos.board[6][3] = new Pawn(1,6,3);
-  pos.board[6][4] = new Pawn(1,6,4);
-  pos.board[6][5] = new Pawn(1,6,5);
-  pos.board[6][6] = new Pawn(1,6,6);
-  pos.board[6][7] = new Pawn(1,6,7);
-  // rank 1 (white)
-  pos.board[7][0] = new Rook(1,7,0);
-  pos.board[7][1] = new Knight(1,7,1);
-  pos.board[7][2] = new Bishop(1,7,2);
-  pos.board[7][3] = new Queen(1,7,3);
-  pos.board[7][4] = new King(1,7,4);
-  pos.board[7][5] = new Bishop(1,7,5);
-  pos.board[7][6] = new Knight(1,7,6);
-  pos.board[7][7] = new Rook(1,7,7);
+  pos.fromFEN(START_FEN);
+}
+
+// set board to a position given in Forsyth-Edwards Notation
+bool setBoard(Position& pos, const string& fen) {
+  return pos.fromFEN(fen);
 }
@@ -0,0 +1,46 @@
+#include "gamestore.hpp"
+#include "movegen.hpp"
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// print usage information
+void usage() {
+  cout << "usage: thinkchess-games <store> [n]\n"
+       << "  prints the number of games, or game n counted from 1\n";
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2 || argc > 3) {
+    usage();
+    return 1;
+  }
+  GameStore store;
+  if (!store.open(argv[1])) {
+    cout << "cannot open game store " << argv[1] << "\n";
+    return 1;
+  }
+  if (argc == 2) {
+    cout << "Games: " << store.size() << "\n";
+    return 0;
+  }
+  uint64_t n = strtoull(argv[2], nullptr, 10);
+  if (n < 1 || n > store.size()) {
+    cout << "no game " << argv[2] << "\n";
+    return 1;
+  }
+  PgnGame game;
+  if (!store.read(n - 1, game)) {
+    cout << "game " << n << " is damaged\n";
+    return 1;
+  }
+  cout << "[White \"" << game.white << "\"]\n"
+       << "[Black \"" << game.black << "\"]\n"
+       << "[Result \"" << game.result << "\"]\n";
+  if (!game.fen.empty()) cout << "[FEN \"" << game.fen << "\"]\n";
+  cout << "\n";
+  for (auto m : game.moves) cout << moveToString(m) << " ";
+  cout << game.result << "\n";
+  return 0;
+}
@@ -0,0 +1,194 @@
+#include "gamestore.hpp"
+#include <cstring>
+
+// write a number in little endian byte order
+void putNumber(unsigned char* p, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) p[i] = (unsigned char)(value >> (8 * i));
+}
+
+// read a number in little endian byte order
+uint64_t getNumber(const unsigned char* p, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; i++) value |= uint64_t(p[i]) << (8 * i);
+  return value;
+}
+
+// convert the notation of a result to GameResult
+int toGameResult(string_view result) {
+  for (int r = RESULT_WHITE; r <= RESULT_DRAW; r++) {
+    if (result == gameResults[r]) return r;
+  }
+  return RESULT_UNKNOWN;
+}
+
+// fixed part of a game record in front of the names
+const size_t RECORD_HEADER = 12;
+
+// open a store, fails if it is missing or damaged
+bool GameStore::open(const string& path) {
+  count = 0;
+  index = nullptr;
+  gamesEnd = 0;
+  if (!file.open(path) || file.size() < GAME_STORE_HEADER) return false;
+  auto data = reinterpret_cast<const unsigned char*>(file.data());
+  if (memcmp(data, "TCGS", 4) != 0 || getNumber(data + 4, 4) != GAME_STORE_VERSION) {
+    return false;
+  }
+  uint64_t games = getNumber(data + 8, 8);
+  uint64_t indexOffset = getNumber(data + 16, 8);
+  if (indexOffset < GAME_STORE_HEADER || indexOffset > file.size()
+      || games > (file.size() - indexOffset) / 8) {
+    return false;
+  }
+  count = games;
+  index = data + indexOffset;
+  gamesEnd = indexOffset;
+  return true;
+}
+
+// start of the record of game n, nullptr if its fixed part is not within
+// the games
+const unsigned char* GameStore::record(uint64_t n) const {
+  if (n >= count) return nullptr;
+  uint64_t offset = getNumber(index + 8 * n, 8);
+  if (offset < GAME_STORE_HEADER || offset > gamesEnd || gamesEnd - offset < RECORD_HEADER) {
+    return nullptr;
+  }
+  return reinterpret_cast<const unsigned char*>(file.data()) + offset;
+}
+
+// metadata of game n, counted from 0
+bool GameStore::info(uint64_t n, GameInfo& info) const {
+  const unsigned char* p = record(n);
+  if (!p) return false;
+  size_t whiteLength = getNumber(p, 2);
+  size_t blackLength = getNumber(p + 2, 2);
+  size_t fenLength = getNumber(p + 4, 2);
+  uint32_t plies = uint32_t(getNumber(p + 8, 4));
+  // the names and moves must end before the index as well
+  uint64_t size = RECORD_HEADER + whiteLength + blackLength + fenLength + 2 * uint64_t(plies);
+  auto start = reinterpret_cast<const unsigned char*>(file.data());
+  if (size > gamesEnd - uint64_t(p - start)) return false;
+  auto text = reinterpret_cast<const char*>(p + RECORD_HEADER);
+  info.white = string_view(text, whiteLength);
+  info.black = string_view(text + whiteLength, blackLength);
+  info.fen = string_view(text + whiteLength + blackLength, fenLength);
+  info.result = p[6] <= RESULT_DRAW ? int(p[6]) : int(RESULT_UNKNOWN);
+  info.plies = plies;
+  return true;
+}
+
+// the whole game n, counted from 0
+bool GameStore::read(uint64_t n, PgnGame& game) const {
+  GameInfo gi;
+  if (!info(n, gi)) return false;
+  game.white = gi.white;
+  game.black = gi.black;
+  game.fen = gi.fen;
+  game.result = gameResults[gi.result];
+  const unsigned char* moves = record(n) + RECORD_HEADER
+                             + gi.white.size() + gi.black.size() + gi.fen.size();
+  game.moves.resize(gi.plies);
+  for (uint32_t i = 0; i < gi.plies; i++) game.moves[i] = Move(getNumber(moves + 2 * i, 2));
+  return true;
+}
+
+// create the store, or open it for appending if it exists
+bool GameStoreWriter::open(const string& path) {
+  close();
+  offsets.clear();
+  failed = false;
+  end = GAME_STORE_HEADER;
+  file = fopen(path.c_str(), "r+b");
+  if (file) {
+    // keep the old games and index, the new games go behind the index, so
+    // the store stays valid until the header points to the new index
+    unsigned char header[GAME_STORE_HEADER];
+    uint64_t games = 0;
+    uint64_t indexOffset = 0;
+    uint64_t size = 0;
+    bool valid = fread(header, 1, GAME_STORE_HEADER, file) == GAME_STORE_HEADER
+              && memcmp(header, "TCGS", 4) == 0
+              && getNumber(header + 4, 4) == GAME_STORE_VERSION
+              && fseeko(file, 0, SEEK_END) == 0;
+    if (valid) {
+      games = getNumber(header + 8, 8);
+      indexOffset = getNumber(header + 16, 8);
+      size = uint64_t(ftello(file));
+      valid = indexOffset >= GAME_STORE_HEADER && indexOffset <= size
+           && games <= (size - indexOffset) / 8;
+    }
+    vector<unsigned char> index(valid ? games * 8 : 0);
+    if (!valid || fseeko(file, off_t(indexOffset), SEEK_SET) != 0
+        || fread(index.data(), 1, index.size(), file) != index.size()) {
+      fclose(file);
+      file = nullptr;
+      return false;
+    }
+    offsets.resize(games);
+    for (uint64_t i = 0; i < games; i++) offsets[i] = getNumber(&index[8 * i], 8);
+    end = size;
+  } else {
+    file = fopen(path.c_str(), "w+b");
+    if (!file) return false;
+  }
+  failed = fseeko(file, off_t(end), SEEK_SET) != 0;
+  return !failed;
+}
+
+// write a game at the end of the store
+void GameStoreWriter::add(const PgnGame& game) {
+  if (!file) return;
+  size_t whiteLength = min<size_t>(game.white.size(), 0xFFFF);
+  size_t blackLength = min<size_t>(game.black.size(), 0xFFFF);
+  size_t fenLength = min<size_t>(game.fen.size(), 0xFFFF);
+  unsigned char header[RECORD_HEADER] = {};
+  putNumber(header, whiteLength, 2);
+  putNumber(header + 2, blackLength, 2);
+  putNumber(header + 4, fenLength, 2);
+  header[6] = (unsigned char)toGameResult(game.result);
+  putNumber(header + 8, game.moves.size(), 4);
+  // the moves are written in small blocks to keep the stack small
+  unsigned char moves[512];
+  size_t written = fwrite(header, 1, RECORD_HEADER, file)
+                 + fwrite(game.white.data(), 1, whiteLength, file)
+                 + fwrite(game.black.data(), 1, blackLength, file)
+                 + fwrite(game.fen.data(), 1, fenLength, file);
+  for (size_t i = 0; i < game.moves.size(); i += sizeof(moves) / 2) {
+    size_t n = min(game.moves.size() - i, sizeof(moves) / 2);
+    for (size_t k = 0; k < n; k++) putNumber(moves + 2 * k, game.moves[i + k], 2);
+    written += fwrite(moves, 1, 2 * n, file);
+  }
+  size_t size = RECORD_HEADER + whiteLength + blackLength + fenLength + 2 * game.moves.size();
+  if (written != size) failed = true;
+  offsets.push_back(end);
+  end += size;
+}
+
+// write the index and the header, fails if anything was not written
+bool GameStoreWriter::close() {
+  if (!file) return !failed;
+  // the index behind the games
+  vector<unsigned char> index(offsets.size() * 8);
+  for (size_t i = 0; i < offsets.size(); i++) putNumber(&index[8 * i], offsets[i], 8);
+  if (fwrite(index.data(), 1, index.size(), file) != index.size()) failed = true;
+  // the header last, it points to the new index; if anything failed the
+  // old header stays, and with it the old games
+  if (fflush(file) != 0) failed = true;
+  if (failed) {
+    fclose(file);
+    file = nullptr;
+    return false;
+  }
+  unsigned char header[GAME_STORE_HEADER] = {'T', 'C', 'G', 'S'};
+  putNumber(header + 4, GAME_STORE_VERSION, 4);
+  putNumber(header + 8, offsets.size(), 8);
+  putNumber(header + 16, end, 8);
+  if (fseeko(file, 0, SEEK_SET) != 0
+      || fwrite(header, 1, GAME_STORE_HEADER, file) != GAME_STORE_HEADER) {
+    failed = true;
+  }
+  if (fclose(file) != 0) failed = true;
+  file = nullptr;
+  return !failed;
+}
@@ -0,0 +1,94 @@
+#include "positionindex.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace chrono;
+
+// print usage information
+void usage() {
+  cout << "usage: thinkchess-index [options] <store> <index>\n"
+       << "       thinkchess-index --probe <index> [fen]\n"
+       << "  --threads N   replay the games with N threads\n"
+       << "  --memory MB   memory of each thread for sorting before writing\n"
+       << "                to disk\n"
+       << "  --probe       print the moves played in a position, the start\n"
+       << "                position if no FEN is given\n";
+}
+
+// print the moves played in a position
+int probe(const string& path, const string& fen) {
+  PositionIndex index;
+  if (!index.open(path)) {
+    cout << "cannot open position index " << path << "\n";
+    return 1;
+  }
+  Position pos(0);
+  if (!pos.fromFEN(fen.empty() ? START_FEN : string_view(fen))) {
+    cout << "invalid FEN " << fen << "\n";
+    return 1;
+  }
+  auto stats = index.moveStats(pos.key);
+  clearPosition(pos);
+  cout << "Move    Games   White  Draws  Black\n";
+  for (auto& s : stats) {
+    cout << left << setw(6) << moveToString(s.move) << right << setw(7) << s.games
+         << fixed << setprecision(1)
+         << setw(7) << 100.0 * s.white / s.games << "%"
+         << setw(6) << 100.0 * s.draws / s.games << "%"
+         << setw(6) << 100.0 * s.black / s.games << "%\n";
+  }
+  if (stats.empty()) cout << "position not found\n";
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  initBitboards();
+
+  int threads = int(thread::hardware_concurrency());
+  size_t memory = 64;
+  bool probing = false;
+  vector<string> paths;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (arg == "--memory" && i + 1 < argc) {
+      memory = strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--probe") {
+      probing = true;
+    } else if (arg[0] != '-' && paths.size() < 2) {
+      paths.push_back(arg);
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (probing && !paths.empty()) return probe(paths[0], paths.size() > 1 ? paths[1] : "");
+  if (probing || paths.size() != 2) {
+    usage();
+    return 1;
+  }
+
+  GameStore store;
+  if (!store.open(paths[0])) {
+    cout << "cannot open game store " << paths[0] << "\n";
+    return 1;
+  }
+  IndexStats stats;
+  auto start = steady_clock::now();
+  if (!buildPositionIndex(store, paths[1], max(threads, 1), memory << 20, stats)) {
+    cout << "cannot write position index " << paths[1] << "\n";
+    return 1;
+  }
+  double seconds = duration<double>(steady_clock::now() - start).count();
+  cout << "Games:     " << stats.games << "\n";
+  if (stats.damaged) cout << "Damaged:   " << stats.damaged << "\n";
+  cout << "Positions: " << stats.entries << "\n";
+  cout << "Runs:      " << stats.runs << "\n";
+  cout << "Time:      " << seconds << " s\n";
+  return 0;
+}
@@ -1,17 +1,25 @@
 #include <SFML/Graphics.hpp>
+#include "analysis.hpp"
 #include "pieces.hpp"
 #include "display.hpp"
 #include "position.hpp"
+#include "positionindex.hpp"
+#include "search.hpp"
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <chrono>
 #include <string>
+#include <thread>
 
 using namespace std;
 using namespace chrono;
 
 int main() {
+  initBitboards();
+  // use the network for the evaluation if there is one
+  loadNetwork("../thinkchess.nnue");
+
   sf::ContextSettings settings;
   settings.antialiasingLevel = 8;
   auto window = sf::RenderWindow{ {870, 640u},
@@ -28,23 +36,36 @@ int main() {
   filesystem::path actGame = "../games/lastGame";
   std::fstream game;
 
-  // games folder
-  const filesystem::path games = "../games";
+  // store the finished games are added to and loaded from
+  const string storePath = "../games/games.tcg";
+  GameStore store;
+
+  // game loaded from the store, the number of its moves made, and the page
+  // of the game loader
+  PgnGame stored;
+  size_t storedPly = 0;
+  uint64_t loadPage = 0;
 
   // board evaluation for evaluation meter
   float eval = 0.f;
 
-  // content of moves history
-  string history;
+  // search results of earlier moves, speed up the evaluation of later ones
+  TranspositionTable tt;
+  tt.resize(16);
+
+  // analysis for the evaluation meter, searches in the background with
+  // one thread per core and restarts on every move
+  Analyzer analyzer(tt, max(1, int(thread::hardware_concurrency())));
 
-  // current line from history
-  string move;
+  // latest analysis result
+  AnalysisInfo analysis;
 
-  // wether end of game has reached
-  bool eog = false;
+  // moves played in the positions of the game database, if it is indexed
+  PositionIndex explorer;
+  explorer.open("../games/games.idx");
 
-  // wether there is a black move
-  bool black = true;
+  // content of moves history
+  string history;
 
   // indicates whether a move was successful
   bool moved = false;
@@ -279,6 +300,43 @@ int main() {
   hist.setFillColor(sf::Color::Black);
   hist.setPosition(670.f, 230.f);
 
+  // most frequent moves of the database in analyze mode
+  sf::Text expl;
+  expl.setFont(noto);
+  expl.setCharacterSize(12);
+  expl.setFillColor(sf::Color::White);
+  expl.setPosition(660.f, 108.f);
+
+  // show the moves of the current position with the share of white wins
+  auto explore = [&]() {
+    string text;
+    auto stats = explorer.moveStats(position.key);
+    for (size_t i = 0; i < stats.size() && i < 5; i++) {
+      auto& s = stats[i];
+      int score = int((100 * s.white + 50 * s.draws) / s.games);
+      text += moveToString(s.move) + " " + to_string(s.games) + "  "
+            + to_string(score) + "%\n";
+    }
+    expl.setString(text);
+  };
+
+  // add a finished game to the store
+  auto storeGame = [&](const string& result) {
+    PgnGame played;
+    played.white = "White";
+    played.black = "Black";
+    played.result = result;
+    played.moves = position.moves;
+    // the store is not read while games are appended
+    store.close();
+    GameStoreWriter writer;
+    if (!writer.open(storePath)) {
+      cout << "failed to open the game store\n";
+      return;
+    }
+    writer.add(played);
+    if (!writer.close()) cout << "failed to store the game\n";
+  };
 
   // game loop
   while (window.isOpen()) {
@@ -296,25 +354,15 @@ int main() {
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::L)) {
           load = true;
           loaded = false;
-          eog = false;
-          black = true;
-          position = Position(2);
+          copyPosition(position, Position(2));
           resetBoard(position);
-          string files;
-          int cnt = 0;
-          for (auto const& game : filesystem::directory_iterator{games}) {
-            files.append(1, '<');
-            files.append(to_string(cnt));
-            cnt++;
-            files.append("> ");
-            string file = game.path();
-            files += file.substr(9);
-            files.append(1, '\n');
-          }
-          tfiles.setString(files);
+          // games are looked up through the index, however many there are
+          store.open(storePath);
+          loadPage = 0;
+          tfiles.setString(listGames(store, loadPage));
         }
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::S)) {
-          position = Position(1);
+          copyPosition(position, Position(1));
           resetBoard(position);
           game.open(actGame, std::ios::trunc);
           if (!game.is_open()) {
@@ -352,6 +400,8 @@ int main() {
           game << "1/2-1/2\n";
           game.flush();
           game.close();
+          storeGame("1/2-1/2");
+          analyzer.stop();
           welcome.setString("     It's a draw!");
         }
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::N) && draw) {
@@ -376,20 +426,25 @@ int main() {
           }
           game.flush();
           game.close();
+          storeGame(position.player ? "0-1" : "1-0");
+          analyzer.stop();
         }
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::N) && giveUp) {
           giveUp = false;
           itt.setString("Okay, move on.");
         }
         // take back move
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::T) && !takeback) {
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::T) && !takeback
+            && position.mvCount > 0) {
           takeback = true;
-          string lastMove = position.moves.back();
+          string lastMove = position.lastMove();
           int sz = lastMove.size();
           moved = position.takeBackMove();
           if (moved) {
+            // the meter follows the position after the takeback
+            analyzer.analyze(position);
             if (position.mvCount > 0) {
-              string newLast = position.moves.back();
+              string newLast = position.lastMove();
               mvi.setString(newLast);
               newLast.back() == '+' ? mvb.setFillColor(sf::Color(200, 100, 0, 200))
                                     : mvb.setFillColor(sf::Color(200, 200, 0, 200));
@@ -442,130 +497,40 @@ int main() {
       }
       // analyze mode
       if (position.gamestate == 2) {
-        // load game file
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Num0) && load) {
-          actGame = getGame(0, games);
-          if (exists(actGame) && is_regular_file(actGame)) {
-            game.open(actGame);
-            load = false;
-          } else {
-            itt.setString("file not found");
-          }
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Num1) && load) {
-          actGame = getGame(1, games);
-          if (exists(actGame) && is_regular_file(actGame)) {
-            game.open(actGame);
-            load = false;
-          } else {
-            itt.setString("file not found");
-          }
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Num2) && load) {
-          actGame = getGame(2, games);
-          if (exists(actGame) && is_regular_file(actGame)) {
-            game.open(actGame);
-            load = false;
-          } else {
-            itt.setString("file not found");
-          }
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Num3) && load) {
-          actGame = getGame(3, games);
-          if (exists(actGame) && is_regular_file(actGame)) {
-            game.open(actGame);
-            load = false;
-          } else {
-            itt.setString("file not found");
-          }
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Num4) && load) {
-          actGame = getGame(4, games);
-          if (exists(actGame) && is_regular_file(actGame)) {
-            game.open(actGame);
-            load = false;
-          } else {
-            itt.setString("file not found");
-          }
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Num5) && load) {
-          actGame = getGame(5, games);
-          if (exists(actGame) && is_regular_file(actGame)) {
-            game.open(actGame);
-            load = false;
-          } else {
-            itt.setString("file not found");
-          }
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Num6) && load) {
-          actGame = getGame(6, games);
-          if (exists(actGame) && is_regular_file(actGame)) {
-            game.open(actGame);
-            load = false;
-          } else {
-            itt.setString("file not found");
-          }
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Num7) && load) {
-          actGame = getGame(7, games);
-          if (exists(actGame) && is_regular_file(actGame)) {
-            game.open(actGame);
-            load = false;
-          } else {
-            itt.setString("file not found");
-          }
-        }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Num8) && load) {
-          actGame = getGame(8, games);
-          if (exists(actGame) && is_regular_file(actGame)) {
-            game.open(actGame);
-            load = false;
-          } else {
-            itt.setString("file not found");
+        // page through the games
+        if (event.type == sf::Event::KeyPressed && load) {
+          if (event.key.code == sf::Keyboard::Down
+              && (loadPage + 1) * GAMES_PER_PAGE < store.size()) {
+            loadPage++;
+          } else if (event.key.code == sf::Keyboard::Up && loadPage > 0) {
+            loadPage--;
           }
+          tfiles.setString(listGames(store, loadPage));
         }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Num9) && load) {
-          actGame = getGame(9, games);
-          if (exists(actGame) && is_regular_file(actGame)) {
-            game.open(actGame);
+        // load the game of a number key
+        for (int k = 0; k < GAMES_PER_PAGE && load; k++) {
+          if (!sf::Keyboard::isKeyPressed(sf::Keyboard::Key(sf::Keyboard::Num0 + k))) continue;
+          uint64_t n = loadPage * GAMES_PER_PAGE + k;
+          // the moves are checked before any of them is made
+          if (n >= store.size()) {
+            itt.setString("game not found");
+          } else if (readStoredGame(store, n, stored)
+                     && position.fromFEN(stored.fen.empty() ? START_FEN
+                                                            : string_view(stored.fen))) {
+            storedPly = 0;
             load = false;
           } else {
-            itt.setString("file not found");
+            stored = PgnGame();
+            itt.setString("damaged game");
           }
         }
         // move forward
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::F) && !moved) {
-          string hm;
-          if (position.mvCount % 2 == 0) {
-            if (getline(game, move)) {
-              auto n = move.find(' ');
-              if (string::npos == n) {
-                itt.setString("reached end of game");
-                eog = true;
-              } else {
-                auto m = move.find(' ', n+1);
-                if (string::npos == m || m == move.size()-1) {
-                  hm = move.substr(n+1, m-n-1);
-                  black = false;
-                } else {
-                  hm = move.substr(n+1, m-n-1);
-                  move = move.substr(m+1);
-                }
-              }
-            } else {
-              itt.setString("reached end of game");
-              eog = true;
-            }
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::F) && !moved && !load) {
+          if (storedPly < stored.moves.size()) {
+            playStoredMove(position, stored.moves[storedPly++]);
+            moved = true;
           } else {
-            if (black) {
-              hm = move;
-            } else {
-              itt.setString("reached end of game");
-              eog = true;
-            }
-          }
-          if (!eog) {
-            moved = position.makeNext(hm);
+            itt.setString("reached end of game");
           }
         }
       } // end analyze mode
@@ -596,13 +561,13 @@ int main() {
         timer = getTime(bTime);
         bTimer.setString(timer);
       }
-      if (position.checkmate.first != -1) {
+      if (position.checkmate.first != -1) { // mated player is on turn
         if (position.player) {
-          bActive.setFillColor(sf::Color(200, 0, 0));
-          window.draw(bActive);
-        } else {
           wActive.setFillColor(sf::Color(200, 0, 0));
           window.draw(wActive);
+        } else {
+          bActive.setFillColor(sf::Color(200, 0, 0));
+          window.draw(bActive);
         }
       }
       window.draw(wTimer);
@@ -625,53 +590,27 @@ int main() {
       mi[3].position = sf::Vector2f(750.f, 100.f);
       mi[2].color = sf::Color::Black;
       mi[3].color = sf::Color::Black;
-      history.clear();
-      string line;
-      while (getline(game, line)) {
-        history += line;
-        history.append(1, '\n');
-      }
+      history = gameHistory(stored);
       hist.setString(history);
       string info = "loaded ";
-      info += actGame.filename();
+      info += stored.white;
+      info += " - ";
+      info += stored.black;
       itt.setString(info);
-      game.close();
-      game.open(actGame);
       loaded = true;
+      explore();
     }
 
     // made move
     if (moved) {
       draw = false;
       takeback = false;
-      if (position.mvCount % 2 == 0) { // update after move completed
-        position.evaluate();
-        eval = position.eval;
-        if (eval >= 10.0) {
-          eval = 10.f;
-          mb[2].color = sf::Color(200, 0, 0, 200);
-          mb[4].color = sf::Color(200, 0, 0, 200);
-          mb[5].color = sf::Color(200, 0, 0, 200);
-        }
-        if (eval <= -10.0) {
-          eval = -10.f;
-          mb[0].color = sf::Color(200, 0, 0, 200);
-          mb[1].color = sf::Color(200, 0, 0, 200);
-          mb[3].color = sf::Color(200, 0, 0, 200);
-        }
-        mi[2].position = sf::Vector2f(750.f + eval*6.f, 80.f);
-        mi[3].position = sf::Vector2f(750.f + eval*6.f, 100.f);
-        if (eval > 0) {
-          mi[2].color = sf::Color::White;
-          mi[3].color = sf::Color::White;
-        } else {
-          mi[2].color = sf::Color::Black;
-          mi[3].color = sf::Color::Black;
-        }
-      }
+      // analyze the new position, the meter follows the results
+      analyzer.analyze(position);
+      if (position.gamestate == 2) explore();
 
       // current move
-      position.mvCount > 0 ? mvi.setString(position.moves.back())
+      position.mvCount > 0 ? mvi.setString(position.lastMove())
                            : mvi.setString("");
       position.checked ? mvb.setFillColor(sf::Color(200, 100, 0, 200))
                        : mvb.setFillColor(sf::Color(200, 200, 0, 200));
@@ -682,15 +621,15 @@ int main() {
     if (position.gamestate == 1 && moved) {
       // write to game file and to moves history
       if (position.mvCount % 2 == 0) {
-        game << position.moves.back() << "\n";
-        history += position.moves.back();
+        game << position.lastMove() << "\n";
+        history += position.lastMove();
         history += "\n";
       } else {
         game << (position.mvCount / 2) + 1 << ". "
-             << position.moves.back() << " ";
+             << position.lastMove() << " ";
         history += to_string((position.mvCount / 2) + 1);
         history += ". ";
-        history += position.moves.back();
+        history += position.lastMove();
         history += " ";
       }
       if (position.mvCount > 52 && position.mvCount % 2 == 1) { // trim history string
@@ -705,9 +644,40 @@ int main() {
       int offset = position.mvCount / 2;
       bcm.setPosition(670.f, 231.f + offset * 14.f);
       window.draw(bcm);
+      window.draw(expl);
       moved = false;
     }
 
+    // update the meter with the latest analysis of the current position
+    if (analyzer.latest(analysis) && analysis.key == position.key) {
+      eval = float(analysis.score) / 100;
+      sf::Color white = sf::Color::White;
+      sf::Color black = sf::Color::Black;
+      if (eval >= 10.0) {
+        eval = 10.f;
+        black = sf::Color(200, 0, 0, 200);
+      }
+      if (eval <= -10.0) {
+        eval = -10.f;
+        white = sf::Color(200, 0, 0, 200);
+      }
+      mb[0].color = white;
+      mb[1].color = white;
+      mb[3].color = white;
+      mb[2].color = black;
+      mb[4].color = black;
+      mb[5].color = black;
+      mi[2].position = sf::Vector2f(750.f + eval*6.f, 80.f);
+      mi[3].position = sf::Vector2f(750.f + eval*6.f, 100.f);
+      if (eval > 0) {
+        mi[2].color = sf::Color::White;
+        mi[3].color = sf::Color::White;
+      } else {
+        mi[2].color = sf::Color::Black;
+        mi[3].color = sf::Color::Black;
+      }
+    }
+
     window.draw(mb);
     window.draw(mi);
     window.draw(hist);
@@ -727,7 +697,9 @@ int main() {
     window.draw(bcb);
     int wc = -1;
     int bc = -1;
-    for (auto piece : position.captured) {
+    for (auto state : position.states) {
+      auto piece = state.captured;
+      if (!piece) continue;
       sf::Sprite cp;
       switch (piece->getType()) {
       case 'K':
@@ -767,8 +739,8 @@ int main() {
     // draw pieces
     for (int row = 0; row < 8; row++) {
       for (int col = 0; col < 8; col++) {
-        if (position.board[row][col]) {
-          auto piece = position.board[row][col];
+        if (position.pieceAt(row, col)) {
+          auto piece = position.pieceAt(row, col);
           sf::Sprite pc;
           switch (piece->getType()) {
           case 'K':
@@ -808,7 +780,8 @@ int main() {
       for (int col = 0; col < 8; col++) {
         if (validMoves[row][col] > 0) {
           valid.setPosition(col*80.f + 20.f, row*80.f + 20.f);
-          if (validMoves[row][col] > 1) valid.setFillColor(sf::Color(0, 200, 0, 200));
+          if (validMoves[row][col] > 2) valid.setFillColor(sf::Color(200, 100, 0, 200));
+          else if (validMoves[row][col] > 1) valid.setFillColor(sf::Color(0, 200, 0, 200));
           else valid.setFillColor(sf::Color(100, 200, 0, 100));
           window.draw(valid);
         }
@@ -820,8 +793,8 @@ int main() {
       window.draw(spt);
       if (position.checkmate.first != -1) {
         string restart;
-        if (position.player) restart = "      White ";
-        else restart = "      Black ";
+        if (position.player) restart = "      Black ";
+        else restart = "      White ";
         restart.append("wins!");
         welcome.setString(restart);
       }
@@ -841,7 +814,7 @@ int main() {
     if (position.gamestate == 1 && position.checkmate.first != -1) {
       position.gamestate = 0;
       if (game.is_open()) {
-        if (position.player) {
+        if (!position.player) {
           game << "\n";
           game << "1-0\n";
         }
@@ -849,6 +822,9 @@ int main() {
         game.flush();
         game.close();
       }
+      // the mated player is on turn
+      storeGame(position.player ? "0-1" : "1-0");
+      analyzer.stop();
     }
 
   } // end game loop
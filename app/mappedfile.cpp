@@ -0,0 +1,38 @@
+#include "mappedfile.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// map the file, fails if it cannot be opened
+bool MappedFile::open(const string& path, bool sequential) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+  length = size_t(st.st_size);
+  if (length > 0) {
+    void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      ::close(fd);
+      length = 0;
+      return false;
+    }
+    madvise(p, length, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    ptr = static_cast<const char*>(p);
+  }
+  // the mapping stays valid without the descriptor
+  ::close(fd);
+  return true;
+}
+
+// unmap the file
+void MappedFile::close() {
+  if (ptr) munmap(const_cast<char*>(ptr), length);
+  ptr = nullptr;
+  length = 0;
+}
@@ -0,0 +1,200 @@
+#include "movegen.hpp"
+
+using namespace std;
+
+// convert a move to coordinate notation, e.g. e2e4 or e7e8q
+string moveToString(Move m) {
+  string move;
+  move.append(1, colToFile(squareCol(moveFrom(m))));
+  move.append(1, rowToRank(squareRow(moveFrom(m))));
+  move.append(1, colToFile(squareCol(moveTo(m))));
+  move.append(1, rowToRank(squareRow(moveTo(m))));
+  if (isPromotion(m)) move.append(1, "nbrq"[promotionType(m) - KNIGHT]);
+  return move;
+}
+
+constexpr Bitboard RANK_1 = 0xFFULL;
+constexpr Bitboard RANK_8 = RANK_1 << 56;
+
+// add moves from one square to all target squares
+void addMoves(const Position& pos, MoveList& list, int from, Bitboard targets) {
+  while (targets) {
+    int to = popLsb(targets);
+    list.add(encodeMove(from, to, pos.squares[to] ? CAPTURE : QUIET));
+  }
+}
+
+// add a pawn move, with all four promotions on the last rank
+void addPawnMove(MoveList& list, int from, int to, int flags) {
+  if (squareBB(to) & (RANK_1 | RANK_8)) {
+    for (int type = QUEEN; type >= KNIGHT; type--) {
+      list.add(encodeMove(from, to, flags | PROMOTION | (type - KNIGHT)));
+    }
+  } else {
+    list.add(encodeMove(from, to, flags));
+  }
+}
+
+// add the moves of all pieces of one type, with the attacks of the type
+// resolved at compile time; pinned pieces stay on the line to their king
+template <PieceType Pt>
+void addPieceMoves(const Position& pos, MoveList& list, Bitboard pcs,
+                   Bitboard targets, Bitboard pinned, int king) {
+  while (pcs) {
+    int from = popLsb(pcs);
+    Bitboard to = attacks<Pt>(from, pos.occupied) & targets;
+    if (pinned & squareBB(from)) to &= lineBB[king][from];
+    addMoves(pos, list, from, to);
+  }
+}
+
+// generate the legal moves of one kind for the given player on turn,
+// specialized per color so the pawn directions are constants
+template <Color Us>
+void generate(const Position& pos, MoveList& list, GenType type, Bitboard sources) {
+  constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+  constexpr int Up = Us == WHITE ? 8 : -8;
+  constexpr Bitboard StartRank = Us == WHITE ? RANK_1 << 8 : RANK_8 >> 8;
+  constexpr Bitboard PromotionRank = Us == WHITE ? RANK_8 : RANK_1;
+  Bitboard own = pos.colors[Us];
+  Bitboard enemies = pos.colors[Them];
+  Bitboard occ = pos.occupied;
+  int king = pos.kingSquare[Us];
+  Bitboard checkers = pos.checkers;
+
+  // squares the pieces may move to for this kind of moves
+  Bitboard kind = type == CAPTURES ? enemies
+                : type == QUIETS ? ~occ : ~own;
+
+  // king moves, the king itself must not block the attacks
+  Bitboard targets = sources & squareBB(king) ? attacks<KING>(king) & kind : 0;
+  while (targets) {
+    int to = popLsb(targets);
+    if (!(pos.attackersTo(to, occ ^ squareBB(king)) & enemies)) {
+      list.add(encodeMove(king, to, pos.squares[to] ? CAPTURE : QUIET));
+    }
+  }
+  // in double check only the king can move
+  if (popCount(checkers) > 1) return;
+
+  // other pieces have to capture the checker or block the check
+  Bitboard checkMask = ~Bitboard(0);
+  if (checkers) {
+    int checker = lsb(checkers);
+    checkMask = betweenBB[king][checker] | checkers;
+  }
+
+  // pieces pinned to the king by enemy sliders
+  Bitboard pinned = 0;
+  Bitboard snipers =
+      (attacks<ROOK>(king) & (pos.pieces[Them][ROOK] | pos.pieces[Them][QUEEN]))
+    | (attacks<BISHOP>(king) & (pos.pieces[Them][BISHOP] | pos.pieces[Them][QUEEN]));
+  while (snipers) {
+    int sniper = popLsb(snipers);
+    Bitboard blockers = betweenBB[king][sniper] & occ;
+    if (popCount(blockers) == 1) pinned |= blockers & own;
+  }
+
+  // knights, bishops, rooks and queens; pinned knights can never move
+  Bitboard pieceTargets = kind & checkMask;
+  addPieceMoves<KNIGHT>(pos, list, pos.pieces[Us][KNIGHT] & sources & ~pinned,
+                        pieceTargets, 0, king);
+  addPieceMoves<BISHOP>(pos, list, pos.pieces[Us][BISHOP] & sources, pieceTargets, pinned, king);
+  addPieceMoves<ROOK>(pos, list, pos.pieces[Us][ROOK] & sources, pieceTargets, pinned, king);
+  addPieceMoves<QUEEN>(pos, list, pos.pieces[Us][QUEEN] & sources, pieceTargets, pinned, king);
+
+  // pawns
+  Bitboard pawns = pos.pieces[Us][PAWN] & sources;
+  while (pawns) {
+    int from = popLsb(pawns);
+    Bitboard pinMask = pinned & squareBB(from) ? lineBB[king][from] : ~Bitboard(0);
+    // pushes, those to the last rank count as captures for the stages
+    int to = from + Up;
+    if (!(occ & squareBB(to))) {
+      bool promotion = squareBB(to) & PromotionRank;
+      if ((squareBB(to) & checkMask & pinMask)
+          && (type == ALL || (type == CAPTURES) == promotion)) {
+        addPawnMove(list, from, to, QUIET);
+      }
+      int to2 = to + Up;
+      if (type != CAPTURES && (squareBB(from) & StartRank) && !(occ & squareBB(to2))
+          && (squareBB(to2) & checkMask & pinMask)) {
+        list.add(encodeMove(from, to2, DOUBLE_PUSH));
+      }
+    }
+    if (type == QUIETS) continue;
+    // captures
+    Bitboard caps = pawnAttacks[Us][from] & enemies & checkMask & pinMask;
+    while (caps) addPawnMove(list, from, popLsb(caps), CAPTURE);
+    // en passant, test the resulting occupancy for discovered attacks
+    if (pos.epSquare != NO_SQUARE && (pawnAttacks[Us][from] & squareBB(pos.epSquare))) {
+      int ep = pos.epSquare;
+      int captured = ep - Up;
+      Bitboard after = (occ ^ squareBB(from) ^ squareBB(captured)) | squareBB(ep);
+      Bitboard remaining = pos.attackersTo(king, after) & enemies & ~squareBB(captured);
+      if (!remaining) list.add(encodeMove(from, ep, EP_CAPTURE));
+    }
+  }
+
+  // castling, the king must not pass or land on an attacked square
+  if (type == CAPTURES || !(sources & squareBB(king))) return;
+  constexpr int Rank = Us == WHITE ? 0 : 56;
+  if (pos.canCastle(Us == WHITE ? WHITE_OO : BLACK_OO)) {
+    list.add(encodeMove(E1 + Rank, G1 + Rank, KING_CASTLE));
+  }
+  if (pos.canCastle(Us == WHITE ? WHITE_OOO : BLACK_OOO)) {
+    list.add(encodeMove(E1 + Rank, C1 + Rank, QUEEN_CASTLE));
+  }
+}
+
+// generate the legal moves of one kind for the player on turn, optionally
+// only those of the pieces on the given squares
+void generateMoves(const Position& pos, MoveList& list, GenType type,
+                   Bitboard sources) {
+  if (pos.player) generate<WHITE>(pos, list, type, sources);
+  else generate<BLACK>(pos, list, type, sources);
+}
+
+// test wether a move, e.g. from the hash table, is legal in the position
+bool isLegal(const Position& pos, Move move) {
+  int from = moveFrom(move);
+  int us = pos.player ? WHITE : BLACK;
+  if (move == NO_MOVE || !(pos.colors[us] & squareBB(from))) return false;
+  MoveList list;
+  generateMoves(pos, list, ALL, squareBB(from));
+  for (auto m : list) {
+    if (m == move) return true;
+  }
+  return false;
+}
+
+// test wether a legal move gives check
+bool givesCheck(const Position& pos, Move move) {
+  int us = pos.player ? WHITE : BLACK;
+  int king = pos.kingSquare[us ^ 1];
+  int from = moveFrom(move);
+  int to = moveTo(move);
+  int flags = moveFlags(move);
+  int type = PAWN;
+  while (!(pos.pieces[us][type] & squareBB(from))) type++;
+  if (isPromotion(move)) type = promotionType(move);
+
+  // direct checks of pawns and knights
+  if (type == PAWN && (pawnAttacks[us][to] & squareBB(king))) return true;
+  if (type == KNIGHT && (knightAttacks[to] & squareBB(king))) return true;
+
+  // sliders after the move, which covers direct and discovered checks
+  Bitboard occ = (pos.occupied ^ squareBB(from)) | squareBB(to);
+  Bitboard diagonal = (pos.pieces[us][BISHOP] | pos.pieces[us][QUEEN]) & ~squareBB(from);
+  Bitboard straight = (pos.pieces[us][ROOK] | pos.pieces[us][QUEEN]) & ~squareBB(from);
+  if (type == BISHOP || type == QUEEN) diagonal |= squareBB(to);
+  if (type == ROOK || type == QUEEN) straight |= squareBB(to);
+  if (flags == EP_CAPTURE) occ ^= squareBB(us == WHITE ? to - 8 : to + 8);
+  if (flags == KING_CASTLE || flags == QUEEN_CASTLE) {
+    Bitboard rook = flags == KING_CASTLE ? squareBB(to + 1) | squareBB(to - 1)
+                                         : squareBB(to - 2) | squareBB(to + 1);
+    occ ^= rook;
+    straight ^= rook;
+  }
+  return (bishopAttacks(king, occ) & diagonal) || (rookAttacks(king, occ) & straight);
+}
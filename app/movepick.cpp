@@ -0,0 +1,171 @@
+#include "movepick.hpp"
+
+using namespace std;
+
+// moves for the main search
+MovePicker::MovePicker(const Position& pos, Move ttMove, const Move killers[2],
+                       Move counter, const int history[64][64])
+  : pos{pos}, ttMove{ttMove}, history{history} {
+  stage = pos.checkers ? EVASION_TT_MOVE : TT_MOVE;
+  // killers and counter move come from other positions, only legal quiet
+  // moves are kept, and each only once; in check they are not used, as
+  // the evasions stage would skip them
+  for (Move m : {killers[0], killers[1], counter}) {
+    if (pos.checkers) break;
+    if (m == ttMove || !m || isCapture(m) || isPromotion(m) || handedOut(m)) continue;
+    if (isLegal(pos, m)) refutations[refutationCount++] = m;
+  }
+  if (!isLegal(pos, ttMove)) this->ttMove = NO_MOVE;
+}
+
+// moves for the quiescence search: captures and promotions, and the
+// quiet moves which give check if asked for; all evasions in check
+MovePicker::MovePicker(const Position& pos, Move ttMove, bool checks)
+  : pos{pos}, ttMove{ttMove}, checks{checks} {
+  stage = pos.checkers ? EVASION_TT_MOVE : QS_TT_MOVE;
+  // only a capture fits the quiescence search
+  if (!pos.checkers && !isCapture(ttMove) && !isPromotion(ttMove)) this->ttMove = NO_MOVE;
+  if (!isLegal(pos, this->ttMove)) this->ttMove = NO_MOVE;
+}
+
+// test wether a move was handed out before the current stage
+bool MovePicker::handedOut(Move m) const {
+  if (m == ttMove) return true;
+  for (int i = 0; i < refutationCount; i++) {
+    if (refutations[i] == m) return true;
+  }
+  return false;
+}
+
+// score the captures by MVV-LVA
+void MovePicker::scoreCaptures() {
+  for (int i = 0; i < list.size; i++) {
+    Move m = list.moves[i];
+    // most valuable victim first, then least valuable attacker
+    int victim = isCapture(m) && moveFlags(m) != EP_CAPTURE
+               ? pos.squares[moveTo(m)]->getPieceType() : PAWN;
+    int attacker = pos.squares[moveFrom(m)]->getPieceType();
+    scores[i] = victim * 8 + (KING - attacker);
+    if (isPromotion(m)) scores[i] += promotionType(m) * 8;
+  }
+}
+
+// score the quiet moves by their history
+void MovePicker::scoreQuiets() {
+  for (int i = 0; i < list.size; i++) {
+    Move m = list.moves[i];
+    scores[i] = history ? history[moveFrom(m)][moveTo(m)] : 0;
+  }
+}
+
+// score the evasions, captures first
+void MovePicker::scoreEvasions() {
+  scoreCaptures();
+  for (int i = 0; i < list.size; i++) {
+    if (isCapture(list.moves[i])) scores[i] += MAX_HISTORY + 64;
+    else scores[i] = history ? history[moveFrom(list.moves[i])][moveTo(list.moves[i])] : 0;
+  }
+}
+
+// the best remaining move of the stage which is not handed out yet
+Move MovePicker::selectBest() {
+  while (current < list.size) {
+    int best = current;
+    for (int i = current + 1; i < list.size; i++) {
+      if (scores[i] > scores[best]) best = i;
+    }
+    swap(list.moves[current], list.moves[best]);
+    swap(scores[current], scores[best]);
+    Move m = list.moves[current++];
+    if (!handedOut(m)) return m;
+  }
+  return NO_MOVE;
+}
+
+// the best remaining move, or NO_MOVE when all were handed out
+Move MovePicker::next() {
+  Move m;
+  switch (stage) {
+  case TT_MOVE:
+  case QS_TT_MOVE:
+  case EVASION_TT_MOVE:
+    stage++;
+    if (ttMove) return ttMove;
+    return next();
+
+  case INIT_CAPTURES:
+  case QS_INIT_CAPTURES:
+    list.size = 0;
+    current = 0;
+    generateMoves(pos, list, CAPTURES);
+    scoreCaptures();
+    stage++;
+    return next();
+
+  case CAPTURES_STAGE:
+    if ((m = selectBest())) return m;
+    current = 0;
+    stage++;
+    return next();
+
+  case REFUTATIONS:
+    if (current < refutationCount) return refutations[current++];
+    stage++;
+    return next();
+
+  case INIT_QUIETS:
+    list.size = 0;
+    current = 0;
+    generateMoves(pos, list, QUIETS);
+    scoreQuiets();
+    stage++;
+    return next();
+
+  case QUIETS_STAGE:
+    if ((m = selectBest())) return m;
+    stage = DONE;
+    return NO_MOVE;
+
+  case QS_CAPTURES:
+    if ((m = selectBest())) return m;
+    stage = checks ? QS_INIT_CHECKS : DONE;
+    return next();
+
+  case QS_INIT_CHECKS:
+    // keep only the quiet moves which give check
+    list.size = 0;
+    current = 0;
+    generateMoves(pos, list, QUIETS);
+    {
+      int n = 0;
+      for (auto move : list) {
+        if (givesCheck(pos, move)) list.moves[n++] = move;
+      }
+      list.size = n;
+    }
+    scoreQuiets();
+    stage++;
+    return next();
+
+  case QS_CHECKS:
+    if ((m = selectBest())) return m;
+    stage = DONE;
+    return NO_MOVE;
+
+  case INIT_EVASIONS:
+    list.size = 0;
+    current = 0;
+    generateMoves(pos, list, ALL);
+    scoreEvasions();
+    stage++;
+    return next();
+
+  case EVASIONS_STAGE:
+    if ((m = selectBest())) return m;
+    stage = DONE;
+    return NO_MOVE;
+
+  default:
+    return NO_MOVE;
+  }
+}
@@ -0,0 +1,226 @@
+#include "nnue.hpp"
+#include "position.hpp"
+#include <fstream>
+#include <vector>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NNUE_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+bool nnueEnabled = false;
+
+// network parameters
+vector<int16_t> ftBiases(NNUE_HIDDEN);
+vector<int16_t> ftWeights;
+vector<int16_t> outWeights(2 * NNUE_HIDDEN);
+int32_t outBias = 0;
+
+// the output is scaled down to centipawns by this factor
+const int OUTPUT_SCALE = 64;
+
+// index of a piece's input as seen from one side, black sees the board mirrored
+int featureIndex(int perspective, int kingSq, int color, int type, int sq) {
+  if (perspective == BLACK) {
+    kingSq ^= 56;
+    sq ^= 56;
+  }
+  int piece = type * 2 + (color != perspective);
+  return kingSq * 640 + piece * 64 + sq;
+}
+
+// scalar kernels, for every CPU
+
+void addScalar(int16_t* acc, const int16_t* w) {
+  for (int i = 0; i < NNUE_HIDDEN; i++) acc[i] += w[i];
+}
+
+void subScalar(int16_t* acc, const int16_t* w) {
+  for (int i = 0; i < NNUE_HIDDEN; i++) acc[i] -= w[i];
+}
+
+// clipped ReLU of the first layer and dot product with the output weights
+int32_t outputScalar(const int16_t* acc, const int16_t* w) {
+  int32_t sum = 0;
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    int x = acc[i] < 0 ? 0 : acc[i] > 127 ? 127 : acc[i];
+    sum += x * w[i];
+  }
+  return sum;
+}
+
+#ifdef NNUE_X86
+
+// AVX2 kernels, 16 values per instruction
+
+__attribute__((target("avx2")))
+void addAvx2(int16_t* acc, const int16_t* w) {
+  for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(w + i));
+    _mm256_storeu_si256((__m256i*)(acc + i), _mm256_add_epi16(a, b));
+  }
+}
+
+__attribute__((target("avx2")))
+void subAvx2(int16_t* acc, const int16_t* w) {
+  for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+    __m256i a = _mm256_loadu_si256((const __m256i*)(acc + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(w + i));
+    _mm256_storeu_si256((__m256i*)(acc + i), _mm256_sub_epi16(a, b));
+  }
+}
+
+__attribute__((target("avx2")))
+int32_t outputAvx2(const int16_t* acc, const int16_t* w) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i max = _mm256_set1_epi16(127);
+  __m256i sum = zero;
+  for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(acc + i));
+    x = _mm256_min_epi16(_mm256_max_epi16(x, zero), max);
+    __m256i y = _mm256_loadu_si256((const __m256i*)(w + i));
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, y));
+  }
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+  return _mm_cvtsi128_si32(s);
+}
+
+// SSE4.1 kernels, 8 values per instruction
+
+__attribute__((target("sse4.1")))
+void addSse41(int16_t* acc, const int16_t* w) {
+  for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(w + i));
+    _mm_storeu_si128((__m128i*)(acc + i), _mm_add_epi16(a, b));
+  }
+}
+
+__attribute__((target("sse4.1")))
+void subSse41(int16_t* acc, const int16_t* w) {
+  for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(acc + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(w + i));
+    _mm_storeu_si128((__m128i*)(acc + i), _mm_sub_epi16(a, b));
+  }
+}
+
+__attribute__((target("sse4.1")))
+int32_t outputSse41(const int16_t* acc, const int16_t* w) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i max = _mm_set1_epi16(127);
+  __m128i sum = zero;
+  for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(acc + i));
+    x = _mm_min_epi16(_mm_max_epi16(x, zero), max);
+    __m128i y = _mm_loadu_si128((const __m128i*)(w + i));
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(x, y));
+  }
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+  return _mm_cvtsi128_si32(sum);
+}
+
+#endif
+
+// kernels picked for the CPU at runtime
+struct Kernels {
+  void (*add)(int16_t*, const int16_t*);
+  void (*sub)(int16_t*, const int16_t*);
+  int32_t (*output)(const int16_t*, const int16_t*);
+  const char* name;
+};
+
+Kernels pickKernels() {
+#ifdef NNUE_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return {addAvx2, subAvx2, outputAvx2, "avx2"};
+  if (__builtin_cpu_supports("sse4.1")) return {addSse41, subSse41, outputSse41, "sse4.1"};
+#endif
+  return {addScalar, subScalar, outputScalar, "scalar"};
+}
+
+const Kernels kernels = pickKernels();
+
+// name of the SIMD kernels picked for this CPU: avx2, sse4.1 or scalar
+const char* nnueKernel() { return kernels.name; }
+
+// read little endian values from the file
+template <typename T>
+bool readValues(ifstream& in, T* values, size_t count) {
+  in.read(reinterpret_cast<char*>(values), count * sizeof(T));
+  return bool(in);
+}
+
+// load a network from a file, the hand written evaluation stays in use
+// if it cannot be read
+bool loadNetwork(const string& path) {
+  ifstream in(path, ios::binary);
+  char magic[4];
+  uint32_t header[3];
+  if (!in || !readValues(in, magic, 4) || string(magic, 4) != "TCNN") return false;
+  if (!readValues(in, header, 3) || header[0] != 1
+      || header[1] != NNUE_INPUTS || header[2] != NNUE_HIDDEN) return false;
+  vector<int16_t> biases(NNUE_HIDDEN);
+  vector<int16_t> weights(size_t(NNUE_INPUTS) * NNUE_HIDDEN);
+  vector<int16_t> output(2 * NNUE_HIDDEN);
+  int32_t bias;
+  if (!readValues(in, biases.data(), biases.size())
+      || !readValues(in, weights.data(), weights.size())
+      || !readValues(in, output.data(), output.size())
+      || !readValues(in, &bias, 1)) return false;
+  ftBiases = move(biases);
+  ftWeights = move(weights);
+  outWeights = move(output);
+  outBias = bias;
+  nnueEnabled = true;
+  return true;
+}
+
+// add or remove the input of a piece, kings mark their side dirty instead
+void nnueUpdate(Accumulator& acc, const int kingSquare[2],
+                int color, int type, int sq, bool add) {
+  if (type == KING) {
+    acc.dirty[color] = true;
+    return;
+  }
+  for (int side = WHITE; side <= BLACK; side++) {
+    if (acc.dirty[side] || kingSquare[side] == NO_SQUARE) continue;
+    const int16_t* w = &ftWeights[size_t(featureIndex(side, kingSquare[side], color, type, sq))
+                                  * NNUE_HIDDEN];
+    if (add) kernels.add(acc.values[side], w);
+    else kernels.sub(acc.values[side], w);
+  }
+}
+
+// recompute the first layer of one side from all pieces on the board
+void refresh(const Position& pos, int side) {
+  int16_t* values = pos.acc.values[side];
+  copy(ftBiases.begin(), ftBiases.end(), values);
+  for (int color = WHITE; color <= BLACK; color++) {
+    for (int type = PAWN; type < KING; type++) {
+      Bitboard bb = pos.pieces[color][type];
+      while (bb) {
+        int index = featureIndex(side, pos.kingSquare[side], color, type, popLsb(bb));
+        kernels.add(values, &ftWeights[size_t(index) * NNUE_HIDDEN]);
+      }
+    }
+  }
+  pos.acc.dirty[side] = false;
+}
+
+// evaluation of the network for the player on turn
+int evaluateNetwork(const Position& pos) {
+  int us = pos.player ? WHITE : BLACK;
+  for (int side = WHITE; side <= BLACK; side++) {
+    if (pos.acc.dirty[side]) refresh(pos, side);
+  }
+  int32_t sum = outBias
+              + kernels.output(pos.acc.values[us], &outWeights[0])
+              + kernels.output(pos.acc.values[us ^ 1], &outWeights[NNUE_HIDDEN]);
+  return sum / OUTPUT_SCALE;
+}
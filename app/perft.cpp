@@ -0,0 +1,178 @@
+#include "display.hpp"
+#include "movegen.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace chrono;
+
+// heap allocations made by the current thread, counted by operator new
+thread_local uint64_t allocations = 0;
+
+void* operator new(size_t size) {
+  allocations++;
+  if (void* p = malloc(size ? size : 1)) return p;
+  throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// cached subtree count, shared by all threads without locks: the key is
+// stored xor the data, so a torn write fails the check and is ignored
+struct PerftEntry {
+  atomic<uint64_t> check;
+  atomic<uint64_t> data; // node count << 8 | depth
+};
+
+// table of cached counts, empty unless --hash is given
+vector<PerftEntry> hashTable;
+
+// look up the node count of a position at the given depth
+bool probe(uint64_t key, int depth, uint64_t& nodes) {
+  if (hashTable.empty()) return false;
+  PerftEntry& e = hashTable[key & (hashTable.size() - 1)];
+  uint64_t data = e.data.load(memory_order_relaxed);
+  if ((e.check.load(memory_order_relaxed) ^ data) != key) return false;
+  if (int(data & 0xFF) != depth) return false;
+  nodes = data >> 8;
+  return true;
+}
+
+// store the node count of a position, always replacing
+void store(uint64_t key, int depth, uint64_t nodes) {
+  if (hashTable.empty()) return;
+  PerftEntry& e = hashTable[key & (hashTable.size() - 1)];
+  uint64_t data = nodes << 8 | uint64_t(depth);
+  e.check.store(key ^ data, memory_order_relaxed);
+  e.data.store(data, memory_order_relaxed);
+}
+
+// count the leaf nodes of the move tree up to the given depth
+uint64_t perft(Position& pos, int depth, bool bulk) {
+  if (depth == 0) return 1;
+  uint64_t nodes = 0;
+  if (depth > 1 && probe(pos.key, depth, nodes)) return nodes;
+  MoveList list;
+  generateLegalMoves(pos, list);
+  // bulk counting: the number of moves is the number of leaves
+  if (bulk && depth == 1) return list.size;
+  for (auto move : list) {
+    pos.doMove(move);
+    nodes += perft(pos, depth - 1, bulk);
+    pos.undoMove();
+  }
+  if (depth > 1) store(pos.key, depth, nodes);
+  return nodes;
+}
+
+// print usage information
+void usage() {
+  cout << "usage: thinkchess-perft [options] <depth> [fen]\n"
+       << "  --divide     print the node count for every root move\n"
+       << "  --threads N  split the root moves over N threads\n"
+       << "  --no-bulk    make and take back the moves at the last ply\n"
+       << "  --hash MB    cache subtree counts in a table of the given size\n"
+       << "  --expect N   fail unless the node count is N, for tests\n";
+}
+
+int main(int argc, char* argv[]) {
+  initBitboards();
+
+  bool divide = false;
+  bool bulk = true;
+  int threads = 1;
+  int hashMB = 0;
+  int depth = -1;
+  long long expected = -1;
+  string fen;
+
+  // parse arguments, all words after the depth form the FEN
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--divide") {
+      divide = true;
+    } else if (arg == "--no-bulk") {
+      bulk = false;
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = max(1, atoi(argv[++i]));
+    } else if (arg == "--hash" && i + 1 < argc) {
+      hashMB = max(0, atoi(argv[++i]));
+    } else if (arg == "--expect" && i + 1 < argc) {
+      expected = atoll(argv[++i]);
+    } else if (depth < 0) {
+      depth = atoi(arg.c_str());
+    } else {
+      if (!fen.empty()) fen.append(1, ' ');
+      fen += arg;
+    }
+  }
+  if (depth < 1) {
+    usage();
+    return 1;
+  }
+  if (fen.empty() || fen == "startpos") fen = START_FEN;
+
+  Position position(0);
+  if (!setBoard(position, fen)) {
+    cout << "invalid FEN: " << fen << "\n";
+    return 1;
+  }
+  MoveList root;
+  generateLegalMoves(position, root);
+
+  // round the table down to a power of two entries
+  if (hashMB > 0) {
+    size_t entries = size_t(hashMB) * 1024 * 1024 / sizeof(PerftEntry);
+    hashTable = vector<PerftEntry>(bit_floor(entries));
+  }
+
+  // the root moves are shared out among the threads
+  vector<uint64_t> counts(root.size, 0);
+  atomic<int> next{0};
+  // making moves must not allocate, only the setup of a worker may
+  atomic<uint64_t> perftAllocations{0};
+  auto worker = [&]() {
+    Position pos(0);
+    setBoard(pos, fen);
+    uint64_t before = allocations;
+    for (int i = next++; i < root.size; i = next++) {
+      pos.doMove(root.moves[i]);
+      counts[i] = perft(pos, depth - 1, bulk);
+      pos.undoMove();
+    }
+    perftAllocations += allocations - before;
+  };
+
+  auto start = steady_clock::now();
+  vector<thread> pool;
+  for (int t = 1; t < threads; t++) pool.emplace_back(worker);
+  worker();
+  for (auto& t : pool) t.join();
+  double seconds = duration<double>(steady_clock::now() - start).count();
+
+  uint64_t nodes = 0;
+  for (int i = 0; i < root.size; i++) {
+    if (divide) cout << moveToString(root.moves[i]) << ": " << counts[i] << "\n";
+    nodes += counts[i];
+  }
+  if (divide) cout << "\n";
+  cout << "Nodes: " << nodes << "\n";
+  cout << "Time:  " << seconds << " s\n";
+  cout << "NPS:   " << uint64_t(seconds > 0 ? nodes / seconds : 0) << "\n";
+  if (perftAllocations) {
+    cout << "error: " << perftAllocations << " heap allocations while making moves\n";
+    return 1;
+  }
+  if (expected >= 0 && nodes != uint64_t(expected)) {
+    cout << "error: expected " << expected << " nodes\n";
+    return 1;
+  }
+  return 0;
+}
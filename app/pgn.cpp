@@ -0,0 +1,281 @@
+#include "pgn.hpp"
+#include "mappedfile.hpp"
+#include "movegen.hpp"
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// find the legal move given in standard algebraic notation
+Move parseSAN(const Position& pos, string_view san) {
+  // check, mate and annotation marks do not identify the move
+  while (!san.empty() && string_view("+#!?").find(san.back()) != string_view::npos) {
+    san.remove_suffix(1);
+  }
+  if (san.empty()) return NO_MOVE;
+  int us = pos.player ? WHITE : BLACK;
+  MoveList list;
+
+  // castling, some files write zeros instead of the letter O
+  if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+    int flag = san.size() == 3 ? KING_CASTLE : QUEEN_CASTLE;
+    generateMoves(pos, list, ALL, pos.pieces[us][KING]);
+    for (auto m : list) {
+      if (moveFlags(m) == flag) return m;
+    }
+    return NO_MOVE;
+  }
+
+  // moving piece, pawns have no letter
+  int type = PAWN;
+  size_t i = 0;
+  if (string_view("NBRQK").find(san[0]) != string_view::npos) {
+    type = pieceType(san[0]);
+    i = 1;
+  }
+  // promotion piece, with or without the equal sign
+  int promotion = -1;
+  if (san.size() > 2 && string_view("NBRQ").find(san.back()) != string_view::npos) {
+    promotion = pieceType(san.back());
+    san.remove_suffix(1);
+    if (san.back() == '=') san.remove_suffix(1);
+  }
+  // only the pieces of the type can make the move
+  generateMoves(pos, list, ALL, pos.pieces[us][type]);
+  // target square
+  if (san.size() < i + 2) return NO_MOVE;
+  char file = san[san.size() - 2];
+  char rank = san[san.size() - 1];
+  if (file < 'a' || file > 'h' || rank < '1' || rank > '8') return NO_MOVE;
+  int to = toSquare(rankToRow(rank), fileToCol(file));
+  // what is left tells apart pieces of the same type, and marks captures
+  int fromCol = -1;
+  int fromRow = -1;
+  for (char c : san.substr(i, san.size() - 2 - i)) {
+    if (c >= 'a' && c <= 'h') fromCol = fileToCol(c);
+    else if (c >= '1' && c <= '8') fromRow = rankToRow(c);
+    else if (c != 'x') return NO_MOVE;
+  }
+
+  Move found = NO_MOVE;
+  for (auto m : list) {
+    int from = moveFrom(m);
+    if (moveTo(m) != to) continue;
+    if (isPromotion(m) ? promotionType(m) != promotion : promotion != -1) continue;
+    if (fromCol >= 0 && squareCol(from) != fromCol) continue;
+    if (fromRow >= 0 && squareRow(from) != fromRow) continue;
+    if (found) return NO_MOVE;
+    found = m;
+  }
+  return found;
+}
+
+// value of a tag pair line, e.g. [White "Carlsen, Magnus"]
+void parseTag(string_view line, PgnGame& game) {
+  size_t space = line.find(' ');
+  size_t open = line.find('"');
+  size_t close = line.rfind('"');
+  if (space == string_view::npos || open == string_view::npos || close <= open) return;
+  string_view name = line.substr(1, space - 1);
+  string_view value = line.substr(open + 1, close - open - 1);
+  if (name == "White") game.white = value;
+  else if (name == "Black") game.black = value;
+  else if (name == "Result") game.result = value;
+  else if (name == "FEN") game.fen = value;
+}
+
+// parse the games of one chunk, replaying the moves on the given position
+void parseChunk(string_view text, Position& pos, vector<PgnGame>& games, PgnStats& stats) {
+  PgnGame game;
+  // a game has begun, its moves are being played, a move was not legal
+  bool started = false;
+  bool playing = false;
+  bool failed = false;
+
+  auto finish = [&]() {
+    if (started) {
+      if (failed) {
+        stats.errors++;
+      } else {
+        stats.games++;
+        stats.moves += game.moves.size();
+        games.push_back(std::move(game));
+      }
+    }
+    game = PgnGame();
+    started = playing = failed = false;
+  };
+
+  size_t n = text.size();
+  size_t i = 0;
+  while (i < n) {
+    char c = text[i];
+    if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+      i++;
+    } else if (c == '[' || (c == '%' && (i == 0 || text[i - 1] == '\n'))) {
+      // tag pair or escaped line, a tag after the moves starts the next game
+      size_t end = text.find('\n', i);
+      if (end == string_view::npos) end = n;
+      if (c == '[') {
+        if (playing) finish();
+        started = true;
+        parseTag(text.substr(i, end - i), game);
+      }
+      i = end;
+    } else if (c == '{') {
+      // comment
+      size_t end = text.find('}', i);
+      i = end == string_view::npos ? n : end + 1;
+    } else if (c == ';') {
+      // comment up to the end of the line
+      size_t end = text.find('\n', i);
+      i = end == string_view::npos ? n : end + 1;
+    } else if (c == '(') {
+      // variation, which may contain further variations and comments
+      int depth = 0;
+      for (; i < n; i++) {
+        if (text[i] == '{') {
+          size_t end = text.find('}', i);
+          i = end == string_view::npos ? n - 1 : end;
+        } else if (text[i] == '(') {
+          depth++;
+        } else if (text[i] == ')' && --depth == 0) {
+          break;
+        }
+      }
+      i++;
+    } else {
+      // a word of the move text: move number, move, annotation or result
+      size_t start = i;
+      while (i < n && string_view(" \n\r\t{}();[").find(text[i]) == string_view::npos) i++;
+      string_view word = text.substr(start, i - start);
+      // a stray closing bracket
+      if (word.empty()) {
+        i++;
+        continue;
+      }
+      if (word == "1-0" || word == "0-1" || word == "1/2-1/2" || word == "*") {
+        if (game.result.empty()) game.result = word;
+        started = true;
+        finish();
+        continue;
+      }
+      if (word[0] == '$') continue;
+      // a move number may be followed by the move without a space
+      if (isdigit((unsigned char)word[0]) && word.rfind("0-0", 0) != 0) {
+        size_t k = 0;
+        while (k < word.size() && (isdigit((unsigned char)word[k]) || word[k] == '.')) k++;
+        word.remove_prefix(k);
+        if (word.empty()) continue;
+      }
+      started = true;
+      if (failed) continue;
+      if (!playing) {
+        playing = true;
+        if (!pos.fromFEN(game.fen.empty() ? START_FEN : string_view(game.fen))) {
+          failed = true;
+          continue;
+        }
+      }
+      Move m = parseSAN(pos, word);
+      if (!m) {
+        failed = true;
+        continue;
+      }
+      pos.doMove(m);
+      game.moves.push_back(m);
+    }
+  }
+  finish();
+}
+
+// find the start of the next line beginning with '[' after a blank line,
+// which is where the tags of a game begin, or npos
+size_t findTags(string_view text, size_t from) {
+  for (size_t pos = text.find("\n[", from); pos != string_view::npos;
+       pos = text.find("\n[", pos + 1)) {
+    // the line before may hold spaces or the '\r' of a Windows line end
+    size_t i = pos;
+    while (i > 0 && (text[i - 1] == ' ' || text[i - 1] == '\t' || text[i - 1] == '\r')) i--;
+    if (i == 0 || text[i - 1] == '\n') return pos + 1;
+  }
+  return string_view::npos;
+}
+
+// split a PGN text into chunks of about the given size, each ending right
+// before the tags of a game
+vector<string_view> splitGames(string_view text, size_t size) {
+  vector<string_view> chunks;
+  size_t start = 0;
+  while (start < text.size()) {
+    size_t end = start + size < text.size() ? findTags(text, start + size)
+                                            : string_view::npos;
+    if (end == string_view::npos) end = text.size();
+    chunks.push_back(text.substr(start, end - start));
+    start = end;
+  }
+  return chunks;
+}
+
+// read the games of a PGN text with the given number of threads
+void importPGN(string_view text, int threads,
+               const function<void(PgnGame&)>& sink, PgnStats& stats) {
+  threads = max(threads, 1);
+  // chunks of a fixed size even out games of different length, and the
+  // threads parse only a few chunks ahead of the one handed over next, so
+  // the games waiting for the sink stay bounded for any size of text
+  vector<string_view> chunks = splitGames(text, PGN_CHUNK_SIZE);
+  const size_t window = size_t(threads) * 4;
+  vector<vector<PgnGame>> results(chunks.size());
+  vector<char> done(chunks.size(), 0);
+  size_t delivered = 0;
+  size_t next = 0;
+  mutex deliver;
+  condition_variable progress;
+
+  auto worker = [&]() {
+    Position pos(0);
+    PgnStats local;
+    unique_lock<mutex> lock(deliver);
+    while (true) {
+      progress.wait(lock, [&]() {
+        return next >= chunks.size() || next < delivered + window;
+      });
+      if (next >= chunks.size()) break;
+      size_t i = next++;
+      lock.unlock();
+      parseChunk(chunks[i], pos, results[i], local);
+      lock.lock();
+      // hand over all chunks which are complete up to here in file order
+      done[i] = 1;
+      size_t before = delivered;
+      while (delivered < chunks.size() && done[delivered]) {
+        for (auto& game : results[delivered]) sink(game);
+        results[delivered] = vector<PgnGame>();
+        delivered++;
+      }
+      if (delivered != before) progress.notify_all();
+    }
+    stats.games += local.games;
+    stats.moves += local.moves;
+    stats.errors += local.errors;
+    lock.unlock();
+    clearPosition(pos);
+  };
+
+  vector<thread> pool;
+  for (int t = 1; t < threads; t++) pool.emplace_back(worker);
+  worker();
+  for (auto& t : pool) t.join();
+  stats.bytes += text.size();
+}
+
+// read the games of a PGN file, which is mapped into memory
+bool importPGN(const string& path, int threads,
+               const function<void(PgnGame&)>& sink, PgnStats& stats) {
+  MappedFile file;
+  if (!file.open(path)) return false;
+  importPGN(string_view(file.data(), file.size()), threads, sink, stats);
+  return true;
+}
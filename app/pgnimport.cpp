@@ -0,0 +1,69 @@
+#include "gamestore.hpp"
+#include "pgn.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace chrono;
+
+// print usage information
+void usage() {
+  cout << "usage: thinkchess-pgn [options] <file.pgn>\n"
+       << "  --threads N   parse with N threads\n"
+       << "  --store FILE  append the games to a game store\n";
+}
+
+int main(int argc, char* argv[]) {
+  initBitboards();
+
+  int threads = int(thread::hardware_concurrency());
+  string path;
+  string storePath;
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (arg == "--store" && i + 1 < argc) {
+      storePath = argv[++i];
+    } else if (path.empty() && arg[0] != '-') {
+      path = arg;
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (path.empty()) {
+    usage();
+    return 1;
+  }
+
+  GameStoreWriter store;
+  if (!storePath.empty() && !store.open(storePath)) {
+    cout << "cannot open game store " << storePath << "\n";
+    return 1;
+  }
+  PgnStats stats;
+  auto start = steady_clock::now();
+  bool ok = importPGN(path, max(threads, 1), [&](PgnGame& game) {
+    if (!storePath.empty()) store.add(game);
+  }, stats);
+  if (!ok) {
+    cout << "cannot open " << path << "\n";
+    return 1;
+  }
+  if (!storePath.empty() && !store.close()) {
+    cout << "cannot write game store " << storePath << "\n";
+    return 1;
+  }
+  double seconds = duration<double>(steady_clock::now() - start).count();
+  cout << "Games:  " << stats.games << "\n";
+  cout << "Moves:  " << stats.moves << "\n";
+  cout << "Errors: " << stats.errors << "\n";
+  cout << "Time:   " << seconds << " s\n";
+  cout << "Speed:  " << fixed << setprecision(1)
+       << (seconds > 0 ? stats.bytes / seconds / 1e6 : 0) << " MB/s\n";
+  return 0;
+}
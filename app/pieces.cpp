@@ -1,109 +1,31 @@
 #include "pieces.hpp"
+#include "position.hpp"
+#include <cstdlib>
+#include <new>
 #include <vector>
 
 using namespace std;
 
-bool King::isValid(const vector<vector<Piece*>>& bd, int r, int c) {
-  bool valid = abs(r-row) <= 1 && abs(c-col) <= 1;
-  return valid;
-}
-
-bool Knight::isValid(const vector<vector<Piece*>>& bd, int r, int c) {
-  bool valid = (abs(r-row) == 1 && abs(c-col) == 2) ||
-               (abs(r-row) == 2 && abs(c-col) == 1);
-  return valid;
-}
-
-bool Rook::isValid(const vector<vector<Piece*>>& bd, int r, int c) {
-  bool valid = r == row || c == col;
-  if (r == row && abs(c-col) > 1) { // same row
-    if (c < col) { // left
-      for (int cc = c+1; cc < col; cc++) {
-        auto pc = bd[r][cc];
-        if (pc) { valid = false; break; }
-      }
-    } else { // right
-      for (int cc = col+1; cc < c; cc++) {
-        auto pc = bd[r][cc];
-        if (pc) { valid = false; break; }
-      }
-    }
-  }
-  if (c == col && abs(r-row) > 1) { // same column
-    if (r < row) { // top
-      for (int rr = r+1; rr < row; rr++) {
-        auto pc = bd[rr][c];
-        if (pc) { valid = false; break; }
-      }
-    } else { // down
-      for (int rr = row+1; rr < r; rr++) {
-        auto pc = bd[rr][c];
-        if (pc) { valid = false; break; }
-      }
-    }
+// convert a piece letter to its piece type
+int pieceType(char type) {
+  switch (type) {
+  case 'N': return KNIGHT;
+  case 'B': return BISHOP;
+  case 'R': return ROOK;
+  case 'Q': return QUEEN;
+  case 'K': return KING;
+  default: return PAWN;
   }
-  return valid;
 }
 
-bool Bishop::isValid(const vector<vector<Piece*>>& bd, int r, int c) {
-  bool valid = r-c == row-col || r+c == row+col;
-  if (r-c == row-col) { // same major diagonal
-    if (r < row) { // upper
-      for (int rr = row-1; rr > r; rr--) {
-        for (int cc = col-1; cc > c; cc--) {
-          if (rr-cc == row-col) {
-            auto pc = bd[rr][cc];
-            if (pc) { valid = false; break; }
-          }
-        }
-      }
-    } else { // lower
-      for (int rr = row+1; rr < r; rr++) {
-        for (int cc = col+1; cc < c; cc++) {
-          if (rr-cc == row-col) {
-            auto pc = bd[rr][cc];
-            if (pc) { valid = false; break; }
-          }
-        }
-      }
-    }
+// test wether the piece may move to the given field, regardless of checks
+bool Piece::isValid(const Position& pos, int r, int c) const {
+  if (type != PAWN) {
+    return attacks(type, toSquare(row, col), pos.occupied) & squareBB(toSquare(r, c));
   }
-  if (r+c == row+col) { // same minor diagonal
-    if (r < row) { // upper
-      for (int rr = row-1; rr > r; rr--) {
-        for (int cc = col+1; cc < c; cc++) {
-          if (rr+cc == row+col) {
-            auto pc = bd[rr][cc];
-            if (pc) { valid = false; break; }
-          }
-        }
-      }
-    } else { // lower
-      for (int rr = row+1; rr < r; rr++) {
-        for (int cc = col-1; cc > c; cc--) {
-          if (rr+cc == row+col) {
-            auto pc = bd[rr][cc];
-            if (pc) { valid = false; break; }
-          }
-        }
-      }
-    }
-  }
-  return valid;
-}
-
-bool Queen::isValid(const vector<vector<Piece*>>& bd, int r, int c) {
-  auto rook = new Rook(white, row, col);
-  auto bishop = new Bishop(white, row, col);
-  bool valid = rook->isValid(bd, r, c) || bishop->isValid(bd, r, c);
-  delete rook;
-  delete bishop;
-  return valid;
-}
-
-bool Pawn::isValid(const vector<vector<Piece*>>& bd, int r, int c) {
+  // pawns move straight and capture diagonally
   bool valid = false;
-  auto pc = bd[r][c];
+  auto pc = pos.pieceAt(r, c);
   if (white) {
     // regular move
     if (r == row-1 && c == col) {
@@ -111,7 +33,7 @@ bool Pawn::isValid(const vector<vector<Piece*>>& bd, int r, int c) {
     }
     // initial move
     if (row == 6 && r == 4 && c == col) {
-      auto pc1 = bd[5][c];
+      auto pc1 = pos.pieceAt(5, c);
       if (!pc1 && !pc) valid = true;
     }
     // capture
@@ -120,12 +42,7 @@ bool Pawn::isValid(const vector<vector<Piece*>>& bd, int r, int c) {
     }
     // en passant
     if (row == 3 && r == 2 && abs(col-c) == 1) {
-      if (!pc) {
-        auto pawn = bd[row][c];
-        if (pawn && pawn->getType() == 'P' && pawn->isWhite() != white) {
-          valid = true;
-        }
-      }
+      if (!pc && toSquare(r, c) == pos.epSquare) valid = true;
     }
   } else { // black
     // regular move
@@ -134,7 +51,7 @@ bool Pawn::isValid(const vector<vector<Piece*>>& bd, int r, int c) {
     }
     // initial move
     if (row == 1 && r == 3 && c == col) {
-      auto pc1 = bd[2][c];
+      auto pc1 = pos.pieceAt(2, c);
       if (!pc1 && !pc) valid = true;
     }
     // capture
@@ -143,14 +60,22 @@ bool Pawn::isValid(const vector<vector<Piece*>>& bd, int r, int c) {
     }
     // en passant
     if (row == 4 && r == 5 && abs(col-c) == 1) {
-      if (!pc) {
-        auto pawn = bd[row][c];
-        if (pawn && pawn->getType() == 'P' && pawn->isWhite() != white) {
-          valid = true;
-        }
-      }
+      if (!pc && toSquare(r, c) == pos.epSquare) valid = true;
     }
   }
   return valid;
 }
 
+// create a piece of the given type in a free slot, nullptr if the pool is full
+Piece* PiecePool::create(int type, bool white, int row, int col) {
+  if (freeCount == 0) return nullptr;
+  return new (storage[freeSlots[--freeCount]]) Piece(type, white, row, col);
+}
+
+// destroy a piece of this pool and reuse its slot
+void PiecePool::destroy(Piece* pc) {
+  if (!pc) return;
+  pc->~Piece();
+  auto slot = (reinterpret_cast<unsigned char*>(pc) - storage[0]) / SLOT;
+  freeSlots[freeCount++] = (unsigned char)slot;
+}
@@ -1,5 +1,9 @@
 #include "position.hpp"
+#include "movegen.hpp"
+#include "tt.hpp"
+#include <cassert>
 #include <cctype>
+#include <charconv>
 #include <utility>
 
 
@@ -23,23 +27,29 @@ pair<int, int> getField(int x, int y) {
   return field;
 }
 
-// convert board coordinates to moves notation
-string convertFromBoard(bool cap, Piece* from, pair<int, int> to) {
-  string move;
-  char type = from->getType();
+// convert a move of a piece type to moves notation, e.g. Ng1-f3
+string convertFromBoard(Move move, char type) {
+  if (moveFlags(move) == KING_CASTLE) return "0-0";
+  if (moveFlags(move) == QUEEN_CASTLE) return "0-0-0";
+  string notation;
   if (type != 'P') {
-    move.append(1, type);
+    notation.append(1, type);
   }
-  move.append(1, colToFile(from->getCol()));
-  move.append(1, rowToRank(from->getRow()));
-  if (cap) {
-    move.append(1, 'x');
+  notation.append(1, colToFile(squareCol(moveFrom(move))));
+  notation.append(1, rowToRank(squareRow(moveFrom(move))));
+  if (isCapture(move)) {
+    notation.append(1, 'x');
   } else {
-    move.append(1, '-');
+    notation.append(1, '-');
   }
-  move.append(1, colToFile(to.second));
-  move.append(1, rowToRank(to.first));
-  return move;
+  notation.append(1, colToFile(squareCol(moveTo(move))));
+  notation.append(1, rowToRank(squareRow(moveTo(move))));
+  if (moveFlags(move) == EP_CAPTURE) notation.append("ep");
+  if (isPromotion(move)) {
+    notation.append(1, '=');
+    notation.append(1, "NBRQ"[promotionType(move) - KNIGHT]);
+  }
+  return notation;
 }
 
 // convert files to colums
@@ -54,115 +64,368 @@ int rankToRow(char rank) {
   return row;
 }
 
-// parse move-string and return coordinates
-vector<int> parseMove(string move) {
-  vector<int> coords(5, 0);
-  if (isupper(move[0])) move.erase(0, 1);
-  for (int i = 0; i < 5; i++) {
-    if (i == 0 || i == 3) { // file
-      coords[i] = fileToCol(move[i]);
-    } else if (i == 1 || i == 4) { // rank
-      coords[i] = rankToRow(move[i]);
-    } else { // captured?
-      move[i] == 'x' ? coords[i] = 1 : coords[i] = 0;
-    }
+// create a copy of a piece in the pool of a position
+Piece* clonePiece(Position& pos, Piece* pc) {
+  if (!pc) return nullptr;
+  return pos.pool.create(pc->getPieceType(), pc->isWhite(), pc->getRow(), pc->getCol());
+}
+
+// copy a position with its own pieces, e.g. for another search thread
+void copyPosition(Position& dst, const Position& src) {
+  clearPosition(dst);
+  dst = src;
+  for (auto& pc : dst.squares) pc = clonePiece(dst, pc);
+  for (auto& st : dst.states) st.captured = clonePiece(dst, st.captured);
+}
+
+// remove all pieces of a position, including the captured ones
+void clearPosition(Position& pos) {
+  for (int sq = 0; sq < 64; sq++) {
+    pos.pool.destroy(pos.removePiece(sq));
+  }
+  for (auto& st : pos.states) {
+    pos.pool.destroy(st.captured);
+    st.captured = nullptr;
   }
-  return coords;
 }
 
-// test for check
-bool check(const vector<vector<Piece*>>& bd, bool white) {
-  Piece* king = nullptr;
-  bool check = false;
-  for (int row = 0; row < 8; row++) {
-    for (int col = 0; col < 8; col++) {
-      auto current = bd[row][col];
-      if (current && current->getType() == 'K' &&
-          current->isWhite() == white)
-      {
-        king = current;
-      }
+// read a number of a FEN field, fails on anything else
+bool parseNumber(string_view field, int& value) {
+  auto end = field.data() + field.size();
+  auto [ptr, ec] = from_chars(field.data(), end, value);
+  return ec == errc() && ptr == end;
+}
+
+// set up the position given in Forsyth-Edwards Notation; the notation is
+// scanned in place, so no strings are created. All fields are read and
+// checked first, the position is only changed if they are valid.
+bool Position::fromFEN(string_view fen) {
+  // fields are separated by spaces
+  size_t i = 0;
+  auto nextField = [&]() {
+    while (i < fen.size() && fen[i] == ' ') i++;
+    size_t start = i;
+    while (i < fen.size() && fen[i] != ' ') i++;
+    return fen.substr(start, i - start);
+  };
+
+  // piece placement, from rank 8 to rank 1
+  Bitboard bb[2][6] = {};
+  int row = 0;
+  int col = 0;
+  int count = 0;
+  for (char c : nextField()) {
+    if (c == '/') {
+      if (col != 8 || ++row > 7) return false;
+      col = 0;
+    } else if (c >= '1' && c <= '8') {
+      col += c - '0';
+      if (col > 8) return false;
+    } else {
+      auto type = string_view("PNBRQK").find(char(toupper(c)));
+      if (type == string_view::npos || col > 7 || ++count > PiecePool::SIZE) return false;
+      bb[isupper(c) ? WHITE : BLACK][type] |= squareBB(toSquare(row, col));
+      col++;
     }
   }
-  if (!king) {
-    throw domain_error{"found no king in check()"};
-  } else {
-    for (int row = 0; row < 8; row++) {
-      for (int col = 0; col < 8; col++) {
-        auto current = bd[row][col];
-        if (current && current->isWhite() != white) {
-          if (current->isValid(bd, king->getRow(), king->getCol())) {
-            check = true;
-          }
-        }
+  if (row != 7 || col != 8) return false;
+  if (popCount(bb[WHITE][KING]) != 1 || popCount(bb[BLACK][KING]) != 1) return false;
+  // pawns never stand on the first or last rank
+  const Bitboard backRanks = 0xFF000000000000FFULL;
+  if ((bb[WHITE][PAWN] | bb[BLACK][PAWN]) & backRanks) return false;
+  Bitboard byColor[2] = {};
+  for (int color = WHITE; color <= BLACK; color++) {
+    for (int type = PAWN; type <= KING; type++) byColor[color] |= bb[color][type];
+  }
+  Bitboard occ = byColor[WHITE] | byColor[BLACK];
+
+  // player on turn
+  string_view side = nextField();
+  if (side != "" && side != "w" && side != "b") return false;
+  bool white = side != "b";
+  int us = white ? WHITE : BLACK;
+  int them = us ^ 1;
+
+  // the king of the player not on turn cannot be in check
+  int ksq = lsb(bb[them][KING]);
+  if ((pawnAttacks[them][ksq] & bb[us][PAWN])
+      || (attacks<KNIGHT>(ksq) & bb[us][KNIGHT])
+      || (attacks<KING>(ksq) & bb[us][KING])
+      || (attacks<BISHOP>(ksq, occ) & (bb[us][BISHOP] | bb[us][QUEEN]))
+      || (attacks<ROOK>(ksq, occ) & (bb[us][ROOK] | bb[us][QUEEN]))) {
+    return false;
+  }
+
+  // castling rights, those without king and rook at home are dropped
+  short rights = 0;
+  for (char c : nextField()) {
+    switch (c) {
+    case 'K': rights |= WHITE_OO; break;
+    case 'Q': rights |= WHITE_OOO; break;
+    case 'k': rights |= BLACK_OO; break;
+    case 'q': rights |= BLACK_OOO; break;
+    case '-': break;
+    default: return false;
+    }
+  }
+  if (!(bb[WHITE][KING] & squareBB(E1))) rights &= ~(WHITE_OO | WHITE_OOO);
+  if (!(bb[WHITE][ROOK] & squareBB(H1))) rights &= ~WHITE_OO;
+  if (!(bb[WHITE][ROOK] & squareBB(A1))) rights &= ~WHITE_OOO;
+  if (!(bb[BLACK][KING] & squareBB(E8))) rights &= ~(BLACK_OO | BLACK_OOO);
+  if (!(bb[BLACK][ROOK] & squareBB(H8))) rights &= ~BLACK_OO;
+  if (!(bb[BLACK][ROOK] & squareBB(A8))) rights &= ~BLACK_OOO;
+
+  // en passant square behind a pawn of the opponent which just moved two
+  // squares; ignored if no pawn can capture, as doMove does
+  int ep = NO_SQUARE;
+  string_view epField = nextField();
+  if (epField.size() == 2) {
+    if (epField[0] < 'a' || epField[0] > 'h' || epField[1] != (white ? '6' : '3')) return false;
+    int sq = toSquare(rankToRow(epField[1]), fileToCol(epField[0]));
+    int pushed = white ? sq - 8 : sq + 8;
+    int origin = white ? sq + 8 : sq - 8;
+    if (!(bb[them][PAWN] & squareBB(pushed)) || (occ & (squareBB(sq) | squareBB(origin)))) {
+      return false;
+    }
+    if (pawnAttacks[them][sq] & bb[us][PAWN]) ep = sq;
+  } else if (epField != "" && epField != "-") {
+    return false;
+  }
+
+  // half move clock and move number, nothing may follow
+  int halfmove = 0;
+  int fullmove = 1;
+  string_view field = nextField();
+  if (!field.empty() && (!parseNumber(field, halfmove) || halfmove < 0)) return false;
+  field = nextField();
+  if (!field.empty() && (!parseNumber(field, fullmove) || fullmove < 0)) return false;
+  if (!nextField().empty()) return false;
+
+  // the notation is valid, set up the position
+  clearPosition(*this);
+  moves.clear();
+  states.clear();
+  mvCount = 0;
+  checkmate = {-1, -1};
+  checked = false;
+  for (int color = WHITE; color <= BLACK; color++) {
+    for (int type = PAWN; type <= KING; type++) {
+      Bitboard b = bb[color][type];
+      while (b) {
+        int sq = popLsb(b);
+        putPiece(pool.create(type, color == WHITE, squareRow(sq), squareCol(sq)));
       }
     }
   }
-  return check;
+  player = white;
+  castlingRights = rights;
+  epSquare = ep;
+  halfmoveClock = halfmove;
+  startPly = 2 * (max(fullmove, 1) - 1) + (player ? 0 : 1);
+  updateCheckers();
+  key = computeKey();
+  return true;
 }
 
-// check wether a given check can be resolved
-bool resolveCheck(vector<vector<Piece*>>& bd, bool player) {
+// write the position in Forsyth-Edwards Notation
+int Position::toFEN(char* buf) const {
+  char* p = buf;
   for (int row = 0; row < 8; row++) {
+    int empty = 0;
     for (int col = 0; col < 8; col++) {
-      auto current = bd[row][col];
-      // get every piece of given color
-      if (current && current->isWhite() == player) {
-        for (int rr = 0; rr < 8; rr++) {
-          for (int cc = 0; cc < 8; cc++) {
-            if (current->isValid(bd, rr, cc)) {
-              auto pct = bd[rr][cc];
-              if (!pct || pct->isWhite() != player) {
-                // make move and test for check
-                bd[rr][cc] = current;
-                current->makeMove(rr, cc);
-                bd[row][col] = nullptr;
-                if (!check(bd, player)) {
-                  // reset move
-                  bd[rr][cc] = pct;
-                  bd[row][col] = current;
-                  current->makeMove(row, col);
-                  return true;
-                } else {
-                  // reset move
-                  bd[rr][cc] = pct;
-                  bd[row][col] = current;
-                  current->makeMove(row, col);
-                }
-              }
-            }
-          }
-        }
+      auto pc = pieceAt(row, col);
+      if (!pc) {
+        empty++;
+        continue;
       }
+      if (empty) *p++ = char('0' + empty);
+      empty = 0;
+      *p++ = pc->isWhite() ? pc->getType() : char(tolower(pc->getType()));
+    }
+    if (empty) *p++ = char('0' + empty);
+    if (row < 7) *p++ = '/';
+  }
+  *p++ = ' ';
+  *p++ = player ? 'w' : 'b';
+  *p++ = ' ';
+  if (castlingRights & WHITE_OO) *p++ = 'K';
+  if (castlingRights & WHITE_OOO) *p++ = 'Q';
+  if (castlingRights & BLACK_OO) *p++ = 'k';
+  if (castlingRights & BLACK_OOO) *p++ = 'q';
+  if (!castlingRights) *p++ = '-';
+  *p++ = ' ';
+  if (epSquare == NO_SQUARE) {
+    *p++ = '-';
+  } else {
+    *p++ = colToFile(squareCol(epSquare));
+    *p++ = rowToRank(squareRow(epSquare));
+  }
+  *p++ = ' ';
+  p = to_chars(p, buf + FEN_SIZE - 1, halfmoveClock).ptr;
+  *p++ = ' ';
+  p = to_chars(p, buf + FEN_SIZE - 1, (startPly + mvCount) / 2 + 1).ptr;
+  *p = 0;
+  return int(p - buf);
+}
+
+// make a legal move and push it on the history
+void Position::doMove(Move m) {
+  int from = moveFrom(m);
+  int to = moveTo(m);
+  int flags = moveFlags(m);
+  int capSq = flags == EP_CAPTURE ? (player ? to - 8 : to + 8) : to;
+  auto captured = isCapture(m) ? squares[capSq] : nullptr;
+  bool pawn = squares[from]->getPieceType() == PAWN;
+  moves.push_back(m);
+  states.push_back({captured, castlingRights, epSquare, halfmoveClock, checkers, key});
+  mvCount++;
+  halfmoveClock = pawn || captured ? 0 : halfmoveClock + 1;
+  // the pieces update the key themselves, the rest is toggled here
+  if (epSquare != NO_SQUARE) key ^= zobristEp[squareCol(epSquare)];
+  key ^= zobristCastling[castlingRights];
+  // only keep an en passant square which an enemy pawn can capture
+  int us = player ? WHITE : BLACK;
+  epSquare = NO_SQUARE;
+  if (flags == DOUBLE_PUSH && (pawnAttacks[us][(from + to) / 2] & pieces[us ^ 1][PAWN])) {
+    epSquare = (from + to) / 2;
+    key ^= zobristEp[squareCol(epSquare)];
+  }
+  castlingRights &= castlingMask(from) & castlingMask(to);
+  key ^= zobristCastling[castlingRights] ^ zobristSide;
+  if (captured) removePiece(capSq);
+  if (isPromotion(m)) {
+    pool.destroy(removePiece(from));
+    putPiece(pool.create(promotionType(m), player, squareRow(to), squareCol(to)));
+  } else {
+    movePiece(from, to);
+  }
+  if (flags == KING_CASTLE) movePiece(to + 1, to - 1);
+  if (flags == QUEEN_CASTLE) movePiece(to - 2, to + 1);
+  // the key is complete, load the table entry while the checkers are found
+  if (tt) tt->prefetch(key);
+  player = !player;
+  updateCheckers();
+  // debug builds verify the incremental scores against a full recompute
+  assert(key == computeKey());
+  assert(psq == computePsq());
+}
+
+// take back the last move of the history
+void Position::undoMove() {
+  Move m = moves.back();
+  const State& st = states.back();
+  int from = moveFrom(m);
+  int to = moveTo(m);
+  int flags = moveFlags(m);
+  player = !player;
+  if (flags == KING_CASTLE) movePiece(to - 1, to + 1);
+  if (flags == QUEEN_CASTLE) movePiece(to + 1, to - 2);
+  if (isPromotion(m)) {
+    pool.destroy(removePiece(to));
+    putPiece(pool.create(PAWN, player, squareRow(from), squareCol(from)));
+  } else {
+    movePiece(to, from);
+  }
+  if (st.captured) putPiece(st.captured);
+  castlingRights = st.castlingRights;
+  epSquare = st.epSquare;
+  halfmoveClock = st.halfmoveClock;
+  checkers = st.checkers;
+  key = st.key;
+  moves.pop_back();
+  states.pop_back();
+  mvCount--;
+}
+
+// make next move from history
+bool Position::makeNext(string move) {
+  checked = false;
+  if (move.back() == '+') {
+    checked = true;
+    move.pop_back();
+  }
+  bool mate = move.back() == '#';
+  if (mate) move.pop_back();
+  int from;
+  int to;
+  int promotion = QUEEN;
+  if (move.rfind("0-0", 0) == 0) { // castling
+    int row = player ? 7 : 0;
+    from = toSquare(row, 4);
+    to = toSquare(row, move == "0-0" ? 6 : 2);
+  } else {
+    size_t i = isupper(move[0]) ? 1 : 0;
+    if (move.size() < i + 5) {
+      info = "invalid move";
+      return false;
+    }
+    from = toSquare(rankToRow(move[i+1]), fileToCol(move[i]));
+    to = toSquare(rankToRow(move[i+4]), fileToCol(move[i+3]));
+    auto eq = move.find('=');
+    if (eq != string::npos && eq + 1 < move.size()) {
+      promotion = pieceType(move[eq+1]);
+    }
+  }
+  MoveList list;
+  generateLegalMoves(*this, list);
+  for (auto mv : list) {
+    if (moveFrom(mv) == from && moveTo(mv) == to &&
+        (!isPromotion(mv) || promotionType(mv) == promotion)) {
+      doMove(mv);
+      if (mate) checkmate = make_pair(squareRow(to), squareCol(to));
+      return true;
     }
   }
+  info = "invalid move";
   return false;
 }
 
+// test for check
+bool check(const Position& pos, bool white) {
+  int color = white ? WHITE : BLACK;
+  if (pos.kingSquare[color] == NO_SQUARE) {
+    throw domain_error{"found no king in check()"};
+  }
+  return pos.isAttacked(pos.kingSquare[color], color ^ 1);
+}
+
+// check wether a given check can be resolved
+bool resolveCheck(Position& pos, bool player) {
+  // generate the moves of the given player, who may not be on turn yet
+  bool onTurn = pos.player;
+  Bitboard checkers = pos.checkers;
+  pos.player = player;
+  pos.updateCheckers();
+  // captures resolve most checks, the quiet moves are only needed without
+  MoveList list;
+  generateMoves(pos, list, CAPTURES);
+  if (list.size == 0) generateMoves(pos, list, QUIETS);
+  pos.player = onTurn;
+  pos.checkers = checkers;
+  return list.size > 0;
+}
+
 // evaluate board
-pair<int, int> evaluateBoard(const vector<vector<Piece*>>& bd) {
+pair<int, int> evaluateBoard(const Position& pos) {
+  const int values[6] = {100, 300, 300, 500, 900, 0};
   int white = 0;
   int black = 0;
-  
-  for (int row = 0; row < 8; row++) {
-    for (int col = 0; col < 8; col++) {
-      auto pc = bd[row][col];
-      if (pc) {
-        pc->isWhite() ? white += pc->getValue() : black += pc->getValue();
-      }
-    }
+
+  for (int type = PAWN; type <= KING; type++) {
+    white += popCount(pos.pieces[WHITE][type]) * values[type];
+    black += popCount(pos.pieces[BLACK][type]) * values[type];
   }
   pair<int, int> eval = make_pair(white, black);
   return eval;
 }
 
 // print board for debug
-void printBoard(const vector<vector<Piece*>>& bd) {
+void printBoard(const Position& pos) {
   cout << "\n";
   for (int row = 0; row < 8; row++) {
     string rank = "";
     for (int col = 0; col < 8; col++) {
-      auto pc = bd[row][col];
+      auto pc = pos.pieceAt(row, col);
       if (pc) {
         rank.append(1, pc->getType());
         rank.append(1, ' ');
@@ -172,4 +435,3 @@ void printBoard(const vector<vector<Piece*>>& bd) {
   }
   cout << "\n";
 }
-
@@ -0,0 +1,320 @@
+#include "positionindex.hpp"
+#include "movegen.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+// order of the entries in the index
+bool entryLess(const IndexEntry& a, const IndexEntry& b) {
+  if (a.key != b.key) return a.key < b.key;
+  if (a.game != b.game) return a.game < b.game;
+  return a.move < b.move;
+}
+
+// write an entry in the file format
+void encodeEntry(unsigned char* p, const IndexEntry& e) {
+  putNumber(p, e.key, 8);
+  putNumber(p + 8, e.game, 4);
+  putNumber(p + 12, e.move, 2);
+  p[14] = e.result;
+  p[15] = 0;
+}
+
+// read an entry in the file format
+IndexEntry decodeEntry(const unsigned char* p) {
+  IndexEntry e;
+  e.key = getNumber(p, 8);
+  e.game = uint32_t(getNumber(p + 8, 4));
+  e.move = Move(getNumber(p + 12, 2));
+  e.result = p[14];
+  return e;
+}
+
+// write sorted entries to a run file
+bool writeRun(const string& name, const vector<IndexEntry>& entries) {
+  FILE* file = fopen(name.c_str(), "wb");
+  if (!file) return false;
+  bool ok = true;
+  unsigned char block[4096 * POSITION_INDEX_ENTRY];
+  for (size_t i = 0; i < entries.size() && ok; i += 4096) {
+    size_t n = min<size_t>(entries.size() - i, 4096);
+    for (size_t k = 0; k < n; k++) encodeEntry(block + k * POSITION_INDEX_ENTRY, entries[i + k]);
+    ok = fwrite(block, POSITION_INDEX_ENTRY, n, file) == n;
+  }
+  if (fclose(file) != 0) ok = false;
+  return ok;
+}
+
+// read the next entry of a run file
+bool readEntry(FILE* file, IndexEntry& e) {
+  unsigned char p[POSITION_INDEX_ENTRY];
+  if (fread(p, 1, POSITION_INDEX_ENTRY, file) != POSITION_INDEX_ENTRY) return false;
+  e = decodeEntry(p);
+  return true;
+}
+
+// runs merged at once, well below the usual limit of open files
+const size_t MERGE_FAN_IN = 64;
+
+// merge sorted run files into an open file, dropping duplicate entries
+bool mergeFiles(const vector<string>& runs, FILE* out, uint64_t& count) {
+  bool ok = true;
+  // the smallest next entry of all runs is on top
+  vector<FILE*> inputs;
+  auto greater = [](const pair<IndexEntry, size_t>& a, const pair<IndexEntry, size_t>& b) {
+    return entryLess(b.first, a.first);
+  };
+  priority_queue<pair<IndexEntry, size_t>, vector<pair<IndexEntry, size_t>>,
+                 decltype(greater)> heap(greater);
+  for (auto& name : runs) {
+    FILE* file = fopen(name.c_str(), "rb");
+    if (!file) {
+      ok = false;
+      break;
+    }
+    inputs.push_back(file);
+    IndexEntry e;
+    if (readEntry(file, e)) heap.push({e, inputs.size() - 1});
+  }
+
+  count = 0;
+  IndexEntry last{};
+  unsigned char block[4096 * POSITION_INDEX_ENTRY];
+  size_t used = 0;
+  while (ok && !heap.empty()) {
+    auto [e, run] = heap.top();
+    heap.pop();
+    // a position repeated in a game with the same move counts once
+    if (count == 0 || entryLess(last, e)) {
+      encodeEntry(block + used * POSITION_INDEX_ENTRY, e);
+      last = e;
+      count++;
+      if (++used == 4096) {
+        ok = fwrite(block, POSITION_INDEX_ENTRY, used, out) == used;
+        used = 0;
+      }
+    }
+    if (readEntry(inputs[run], e)) heap.push({e, run});
+  }
+  if (ok && used > 0) ok = fwrite(block, POSITION_INDEX_ENTRY, used, out) == used;
+  for (auto file : inputs) fclose(file);
+  return ok;
+}
+
+// merge sorted runs into a longer run
+bool mergeToRun(const vector<string>& runs, const string& name) {
+  FILE* out = fopen(name.c_str(), "wb");
+  if (!out) return false;
+  uint64_t count = 0;
+  bool ok = mergeFiles(runs, out, count);
+  if (fclose(out) != 0) ok = false;
+  return ok;
+}
+
+// merge the last runs into the index; the header is written last
+bool writeIndex(const vector<string>& runs, const string& path,
+                uint64_t storeGames, uint64_t& count) {
+  FILE* out = fopen(path.c_str(), "wb");
+  if (!out) return false;
+  unsigned char header[POSITION_INDEX_HEADER] = {};
+  bool ok = fwrite(header, 1, POSITION_INDEX_HEADER, out) == POSITION_INDEX_HEADER;
+  if (ok) ok = mergeFiles(runs, out, count);
+  memcpy(header, "TCPI", 4);
+  putNumber(header + 4, POSITION_INDEX_VERSION, 4);
+  putNumber(header + 8, count, 8);
+  putNumber(header + 16, storeGames, 8);
+  if (fflush(out) != 0 || fseeko(out, 0, SEEK_SET) != 0
+      || fwrite(header, 1, POSITION_INDEX_HEADER, out) != POSITION_INDEX_HEADER) {
+    ok = false;
+  }
+  if (fclose(out) != 0) ok = false;
+  return ok;
+}
+
+// build the index of a game store with the given number of threads
+bool buildPositionIndex(const GameStore& store, const string& path, int threads,
+                        size_t memory, IndexStats& stats) {
+  threads = max(threads, 1);
+  // entries a thread collects before it sorts them into a run
+  size_t capacity = max<size_t>(memory / sizeof(IndexEntry), 1 << 16);
+  // games are handed out in blocks, which keeps the threads busy to the end
+  const uint64_t block = 64;
+  atomic<uint64_t> next{0};
+  atomic<bool> failed{false};
+  vector<string> runs;
+  // every run file made, to be removed at the end
+  vector<string> files;
+  mutex lock;
+
+  // name of a new run file
+  auto newRun = [&]() {
+    files.push_back(path + ".run" + to_string(files.size()));
+    return files.back();
+  };
+
+  // sort the entries of a thread and write them to a new run
+  auto spill = [&](vector<IndexEntry>& entries) {
+    sort(entries.begin(), entries.end(), entryLess);
+    string name;
+    {
+      lock_guard<mutex> guard(lock);
+      name = newRun();
+      runs.push_back(name);
+    }
+    if (!writeRun(name, entries)) failed = true;
+    entries.clear();
+  };
+
+  auto worker = [&]() {
+    Position pos(0);
+    PgnGame game;
+    vector<IndexEntry> entries;
+    entries.reserve(capacity);
+    // entries of the game being replayed
+    vector<IndexEntry> current;
+    uint64_t games = 0;
+    uint64_t damaged = 0;
+    for (uint64_t first = next.fetch_add(block); first < store.size() && !failed;
+         first = next.fetch_add(block)) {
+      uint64_t last = min(first + block, store.size());
+      for (uint64_t g = first; g < last; g++) {
+        // damaged games are left out
+        GameInfo info;
+        if (!store.info(g, info) || !store.read(g, game)
+            || !pos.fromFEN(game.fen.empty() ? START_FEN : string_view(game.fen))) {
+          damaged++;
+          continue;
+        }
+        uint8_t result = uint8_t(info.result);
+        // replay the game, every position before a move is an entry; the
+        // moves are checked, so a game with an illegal move adds no entries
+        current.clear();
+        bool legal = true;
+        for (auto m : game.moves) {
+          if (!isLegal(pos, m)) {
+            legal = false;
+            break;
+          }
+          current.push_back({pos.key, uint32_t(g), m, result});
+          pos.doMove(m);
+        }
+        if (!legal) {
+          damaged++;
+          continue;
+        }
+        for (auto& e : current) {
+          entries.push_back(e);
+          if (entries.size() == capacity) spill(entries);
+        }
+        games++;
+      }
+    }
+    if (!entries.empty()) spill(entries);
+    lock_guard<mutex> guard(lock);
+    stats.games += games;
+    stats.damaged += damaged;
+    clearPosition(pos);
+  };
+
+  vector<thread> pool;
+  for (int t = 1; t < threads; t++) pool.emplace_back(worker);
+  worker();
+  for (auto& t : pool) t.join();
+
+  stats.runs += runs.size();
+
+  // merge at most MERGE_FAN_IN runs at once, in passes until few are left
+  bool ok = !failed;
+  while (ok && runs.size() > MERGE_FAN_IN) {
+    vector<string> merged;
+    for (size_t i = 0; i < runs.size() && ok; i += MERGE_FAN_IN) {
+      vector<string> group(runs.begin() + i, runs.begin() + min(i + MERGE_FAN_IN, runs.size()));
+      merged.push_back(newRun());
+      ok = mergeToRun(group, merged.back());
+      for (auto& name : group) remove(name.c_str());
+    }
+    runs = merged;
+  }
+
+  // the last pass writes the index under a temporary name, so an open
+  // index stays valid until then
+  string temp = path + ".tmp";
+  uint64_t count = 0;
+  if (ok) ok = writeIndex(runs, temp, store.size(), count);
+  for (auto& name : files) remove(name.c_str());
+  if (ok) ok = rename(temp.c_str(), path.c_str()) == 0;
+  if (!ok) remove(temp.c_str());
+  stats.entries += count;
+  return ok;
+}
+
+// open an index, fails if it is missing or damaged
+bool PositionIndex::open(const string& path) {
+  count = 0;
+  storeGames = 0;
+  entries = nullptr;
+  // lookups jump around in the file, reading ahead would not help
+  if (!file.open(path, false) || file.size() < POSITION_INDEX_HEADER) return false;
+  auto data = reinterpret_cast<const unsigned char*>(file.data());
+  if (memcmp(data, "TCPI", 4) != 0 || getNumber(data + 4, 4) != POSITION_INDEX_VERSION) {
+    return false;
+  }
+  uint64_t n = getNumber(data + 8, 8);
+  if (n > (file.size() - POSITION_INDEX_HEADER) / POSITION_INDEX_ENTRY) return false;
+  count = n;
+  storeGames = getNumber(data + 16, 8);
+  entries = data + POSITION_INDEX_HEADER;
+  return true;
+}
+
+// entry i, counted from 0
+IndexEntry PositionIndex::entry(uint64_t i) const {
+  return decodeEntry(entries + i * POSITION_INDEX_ENTRY);
+}
+
+// first entry of the position and the end of its entries
+pair<uint64_t, uint64_t> PositionIndex::find(uint64_t key) const {
+  // first entry with a key not less than the given one
+  auto lowerBound = [&](uint64_t k) {
+    uint64_t low = 0;
+    uint64_t high = count;
+    while (low < high) {
+      uint64_t mid = low + (high - low) / 2;
+      if (getNumber(entries + mid * POSITION_INDEX_ENTRY, 8) < k) low = mid + 1;
+      else high = mid;
+    }
+    return low;
+  };
+  uint64_t first = lowerBound(key);
+  uint64_t last = first;
+  while (last < count && getNumber(entries + last * POSITION_INDEX_ENTRY, 8) == key) last++;
+  return {first, last};
+}
+
+// moves played in the position, the most frequent first
+vector<MoveStats> PositionIndex::moveStats(uint64_t key) const {
+  vector<MoveStats> stats;
+  auto [first, last] = find(key);
+  for (uint64_t i = first; i < last; i++) {
+    IndexEntry e = entry(i);
+    // a position has only a few different moves
+    auto it = find_if(stats.begin(), stats.end(),
+                      [&](const MoveStats& s) { return s.move == e.move; });
+    if (it == stats.end()) {
+      stats.push_back(MoveStats());
+      it = stats.end() - 1;
+      it->move = e.move;
+    }
+    it->games++;
+    if (e.result == RESULT_WHITE) it->white++;
+    else if (e.result == RESULT_DRAW) it->draws++;
+    else if (e.result == RESULT_BLACK) it->black++;
+  }
+  stable_sort(stats.begin(), stats.end(),
+              [](const MoveStats& a, const MoveStats& b) { return a.games > b.games; });
+  return stats;
+}
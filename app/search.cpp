@@ -0,0 +1,306 @@
+#include "search.hpp"
+#include "evaluate.hpp"
+#include "movepick.hpp"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+using namespace std;
+using namespace chrono;
+
+// mate scores are stored relative to the node, not to the root
+int scoreToTT(int score, int ply) {
+  if (score >= MATE_BOUND) return score + ply;
+  if (score <= -MATE_BOUND) return score - ply;
+  return score;
+}
+
+int scoreFromTT(int score, int ply) {
+  if (score >= MATE_BOUND) return score - ply;
+  if (score <= -MATE_BOUND) return score + ply;
+  return score;
+}
+
+// depths the helpers skip: helper i leaves out the iterations where
+// (depth + SKIP_PHASE[i]) / SKIP_SIZE[i] is odd, so the helpers search
+// different depths from the main thread and from each other
+const int SKIP_SIZE[20] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+const int SKIP_PHASE[20] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+// milliseconds since the search started
+int64_t Search::elapsed() const {
+  return duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+// test the node and time limits, sets stopped when exceeded
+void Search::checkLimits() {
+  if (stop.load(memory_order_relaxed)
+      || (abort && abort->load(memory_order_relaxed))
+      || (limits.nodes && nodes >= limits.nodes)
+      || (limits.movetime && elapsed() >= limits.movetime)) {
+    stopped = true;
+  }
+}
+
+// test wether the position is drawn by repetition or the 50 moves rule
+bool Search::isDraw() const {
+  if (pos.halfmoveClock >= 100) return true;
+  // only positions since the last capture or pawn move can repeat,
+  // and only every second one has the same player on turn
+  int n = int(pos.states.size());
+  for (int i = n - 4; i >= 0 && i >= n - pos.halfmoveClock; i -= 2) {
+    if (pos.states[i].key == pos.key) return true;
+  }
+  return false;
+}
+
+// score of a position after the captures settled down, so leaves are not
+// scored in the middle of an exchange; at its first ply quiet checks are
+// tried as well, depth counts down from 0 below that
+int Search::quiesce(int depth, int ply, int alpha, int beta) {
+  pvLength[ply] = ply;
+  nodes++;
+  if ((nodes & 1023) == 0) checkLimits();
+  if (stopped) return 0;
+  if (ply >= MAX_PLY) return evaluate(pos);
+
+  // the player may stand pat instead of capturing, unless in check
+  bool inCheck = pos.checkers;
+  int best = -INFINITE;
+  if (!inCheck) {
+    best = evaluate(pos);
+    if (best >= beta) return best;
+    alpha = max(alpha, best);
+  }
+
+  // in check all evasions are tried, else captures, promotions and checks
+  // which do not lose material
+  MovePicker picker(pos, NO_MOVE, depth == 0);
+  int moveCount = 0;
+  for (Move move = picker.next(); move; move = picker.next()) {
+    moveCount++;
+    if (!inCheck && see(pos, move) < 0) continue;
+
+    pos.doMove(move);
+    int score = -quiesce(depth - 1, ply + 1, -beta, -alpha);
+    pos.undoMove();
+    if (stopped) return 0;
+
+    if (score > best) {
+      best = score;
+      if (score > alpha) {
+        alpha = score;
+        if (alpha >= beta) break;
+      }
+    }
+  }
+  if (inCheck && moveCount == 0) return -MATE + ply;
+  return best;
+}
+
+// remember a quiet move which caused a cutoff, and lower the history of
+// the quiet moves tried before it
+void Search::updateQuietStats(Move move, int ply, int depth,
+                              const Move* quiets, int quietCount) {
+  if (killers[ply][0] != move) {
+    killers[ply][1] = killers[ply][0];
+    killers[ply][0] = move;
+  }
+  int us = pos.player ? WHITE : BLACK;
+  int bonus = min(depth * depth, 400);
+  updateHistory(history[us][moveFrom(move)][moveTo(move)], bonus);
+  for (int i = 0; i < quietCount; i++) {
+    updateHistory(history[us][moveFrom(quiets[i])][moveTo(quiets[i])], -bonus);
+  }
+  if (!pos.moves.empty()) {
+    Move last = pos.moves.back();
+    counterMoves[moveFrom(last)][moveTo(last)] = move;
+  }
+}
+
+// score of the position searched to the given depth
+int Search::negamax(int depth, int ply, int alpha, int beta) {
+  if (depth <= 0) return quiesce(0, ply, alpha, beta);
+  pvLength[ply] = ply;
+  nodes++;
+  if ((nodes & 1023) == 0) checkLimits();
+  if (stopped) return 0;
+  if (ply > 0 && isDraw()) return 0;
+  if (ply >= MAX_PLY) return evaluate(pos);
+
+  // a stored result may already decide the node, outside the main line
+  bool pvNode = beta - alpha > 1;
+  Move ttMove = NO_MOVE;
+  TTData tte;
+  if (tt && tt->probe(pos.key, tte)) {
+    ttMove = tte.move;
+    int score = scoreFromTT(tte.score, ply);
+    if (!pvNode && tte.depth >= depth
+        && (tte.bound == BOUND_EXACT
+            || (tte.bound == BOUND_LOWER && score >= beta)
+            || (tte.bound == BOUND_UPPER && score <= alpha))) {
+      return score;
+    }
+  }
+
+  // the counter move answers the opponent's last move
+  int us = pos.player ? WHITE : BLACK;
+  Move counter = NO_MOVE;
+  if (!pos.moves.empty()) {
+    Move last = pos.moves.back();
+    counter = counterMoves[moveFrom(last)][moveTo(last)];
+  }
+  MovePicker picker(pos, ttMove, killers[ply], counter, history[us]);
+
+  int alphaOrig = alpha;
+  int best = -INFINITE;
+  Move bestMove = NO_MOVE;
+  Move quiets[MAX_MOVES];
+  int quietCount = 0;
+  int moveCount = 0;
+  for (Move move = picker.next(); move; move = picker.next()) {
+    moveCount++;
+    pos.doMove(move);
+    int score = -negamax(depth - 1, ply + 1, -beta, -alpha);
+    pos.undoMove();
+    if (stopped) return 0;
+
+    bool quiet = !isCapture(move) && !isPromotion(move);
+    if (score > best) {
+      best = score;
+      bestMove = move;
+      if (score > alpha) {
+        alpha = score;
+        // the line of this node is the move followed by the line of the child
+        pvTable[ply][ply] = move;
+        for (int i = ply + 1; i < pvLength[ply + 1]; i++) {
+          pvTable[ply][i] = pvTable[ply + 1][i];
+        }
+        pvLength[ply] = max(pvLength[ply + 1], ply + 1);
+        if (alpha >= beta) {
+          if (quiet) updateQuietStats(move, ply, depth, quiets, quietCount);
+          break;
+        }
+      }
+    }
+    if (quiet) quiets[quietCount++] = move;
+  }
+
+  if (moveCount == 0) return pos.checkers ? -MATE + ply : 0;
+
+  if (tt) {
+    Bound bound = best >= beta ? BOUND_LOWER
+                : best > alphaOrig ? BOUND_EXACT : BOUND_UPPER;
+    tt->store(pos.key, depth, bound, scoreToTT(best, ply), bestMove);
+  }
+  return best;
+}
+
+// deepen the search iteration by iteration until a limit is reached
+SearchResult Search::iterate() {
+  SearchResult result;
+  MoveList root;
+  generateLegalMoves(pos, root);
+  if (root.size == 0) {
+    result.score = pos.checkers ? -MATE : 0;
+    return result;
+  }
+  result.bestMove = root.moves[0];
+
+  // the move ordering tables start empty for every search
+  memset(killers, 0, sizeof(killers));
+  memset(history, 0, sizeof(history));
+  memset(counterMoves, 0, sizeof(counterMoves));
+
+  uint64_t lastIteration = 0;
+  for (int depth = 1; depth <= min(limits.depth, MAX_PLY); depth++) {
+    // the helpers skip depths by their schedule and fill the table ahead
+    // of the main thread, which searches every depth
+    if (id > 0) {
+      int i = (id - 1) % 20;
+      if (((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2) {
+        lastIteration = 0;
+        continue;
+      }
+    }
+    uint64_t before = nodes;
+    int score = negamax(depth, 0, -INFINITE, INFINITE);
+    // an interrupted iteration is not trusted
+    if (stopped) break;
+    // nodes of this iteration compared with the previous one
+    uint64_t iteration = nodes - before;
+    if (lastIteration) result.branching = double(iteration) / double(lastIteration);
+    lastIteration = iteration;
+    result.score = score;
+    result.depth = depth;
+    result.pv.assign(pvTable[0], pvTable[0] + pvLength[0]);
+    if (!result.pv.empty()) result.bestMove = result.pv[0];
+    result.nodes = nodes;
+    result.time = elapsed();
+    if (id == 0 && report) report(result);
+    // a found mate will not get better, and a deeper iteration
+    // would not finish in the time left
+    if (abs(score) >= MATE_BOUND) break;
+    if (limits.movetime && elapsed() * 2 > limits.movetime) break;
+  }
+  return result;
+}
+
+// search the position within the limits and return the best line
+SearchResult Search::run(const SearchLimits& searchLimits) {
+  limits = searchLimits;
+  start = steady_clock::now();
+  nodes = 0;
+  stopped = false;
+  auto oldTT = pos.tt;
+  pos.tt = tt;
+  if (tt && id == 0) tt->newSearch();
+
+  // the helpers only stop on the depth limit or when told by the main thread
+  SearchLimits helperLimits;
+  helperLimits.depth = limits.depth;
+  vector<unique_ptr<Position>> positions;
+  vector<unique_ptr<Search>> helpers;
+  vector<SearchResult> results(max(threads, 1));
+  vector<thread> pool;
+  for (int i = 1; i < threads; i++) {
+    positions.push_back(make_unique<Position>(0));
+    copyPosition(*positions.back(), pos);
+    helpers.push_back(make_unique<Search>(*positions.back(), tt, i));
+    Search* helper = helpers.back().get();
+    pool.emplace_back([helper, &results, &helperLimits, i]() {
+      results[i] = helper->run(helperLimits);
+    });
+  }
+
+  SearchResult result = iterate();
+  for (auto& helper : helpers) helper->stop = true;
+  for (auto& t : pool) t.join();
+
+  // take the line of the deepest completed iteration, and count all nodes
+  result.nodes = nodes;
+  for (size_t i = 0; i < helpers.size(); i++) {
+    const SearchResult& r = results[i + 1];
+    if (r.depth > result.depth && r.bestMove) {
+      result.bestMove = r.bestMove;
+      result.score = r.score;
+      result.depth = r.depth;
+      result.branching = r.branching;
+      result.pv = r.pv;
+    }
+    result.nodes += r.nodes;
+    clearPosition(*positions[i]);
+  }
+  result.time = elapsed();
+  pos.tt = oldTT;
+  return result;
+}
+
+// search the position within the limits, using the table if given
+SearchResult search(Position& pos, const SearchLimits& limits,
+                    TranspositionTable* tt, int threads) {
+  Search s(pos, tt);
+  s.threads = threads;
+  return s.run(limits);
+}
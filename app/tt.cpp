@@ -0,0 +1,106 @@
+#include "tt.hpp"
+#include <bit>
+#include <thread>
+
+using namespace std;
+
+// pack the fields of an entry into one word
+uint64_t packEntry(Move move, int score, int depth, Bound bound, int age) {
+  return uint64_t(move)
+       | uint64_t(uint16_t(int16_t(score))) << 16
+       | uint64_t(uint8_t(int8_t(depth))) << 32
+       | uint64_t(bound) << 40
+       | uint64_t(age) << 42;
+}
+
+// fields of a packed entry
+int entryDepth(uint64_t data) { return int8_t(data >> 32); }
+Bound entryBound(uint64_t data) { return Bound((data >> 40) & 3); }
+int entryAge(uint64_t data) { return (data >> 42) & 63; }
+
+// allocate a table of the given size in MB, rounded down to a power of two
+void TranspositionTable::resize(size_t mb) {
+  size_t count = bit_floor(max<size_t>(1, (mb << 20) / sizeof(TTBucket)));
+  if (count == buckets.size()) return;
+  buckets = vector<TTBucket>(count);
+}
+
+// empty all entries, using several threads for large tables
+void TranspositionTable::clear(int threads) {
+  size_t count = buckets.size();
+  auto clearRange = [this](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      for (auto& e : buckets[i].entries) {
+        e.check.store(0, memory_order_relaxed);
+        e.data.store(0, memory_order_relaxed);
+      }
+    }
+  };
+  vector<thread> pool;
+  size_t chunk = count / max(1, threads);
+  for (int t = 1; t < threads; t++) {
+    pool.emplace_back(clearRange, t * chunk, t + 1 == threads ? count : (t + 1) * chunk);
+  }
+  clearRange(0, threads > 1 ? chunk : count);
+  for (auto& t : pool) t.join();
+  age = 0;
+}
+
+// look up a position, returns false if it is not stored
+bool TranspositionTable::probe(uint64_t key, TTData& tte) const {
+  if (buckets.empty()) return false;
+  for (auto& e : bucket(key).entries) {
+    uint64_t data = e.data.load(memory_order_relaxed);
+    if ((e.check.load(memory_order_relaxed) ^ data) != key) continue;
+    if (entryBound(data) == BOUND_NONE) continue;
+    tte.move = Move(data & 0xFFFF);
+    tte.score = int16_t(data >> 16);
+    tte.depth = entryDepth(data);
+    tte.bound = entryBound(data);
+    return true;
+  }
+  return false;
+}
+
+// store a search result, preferring to replace shallow and old entries
+void TranspositionTable::store(uint64_t key, int depth, Bound bound, int score, Move move) {
+  if (buckets.empty()) return;
+  TTEntry* replace = nullptr;
+  int worst = INT32_MAX;
+  for (auto& e : bucket(key).entries) {
+    uint64_t data = e.data.load(memory_order_relaxed);
+    if ((e.check.load(memory_order_relaxed) ^ data) == key) {
+      // same position: keep the old move if the new result has none, and
+      // keep a deeper result of this search unless the new one is exact
+      if (!move) move = Move(data & 0xFFFF);
+      if (bound != BOUND_EXACT && entryAge(data) == age && entryDepth(data) > depth + 2) {
+        return;
+      }
+      replace = &e;
+      break;
+    }
+    // entries of old searches count as less deep, free entries as least
+    int relativeAge = (age - entryAge(data)) & 63;
+    int value = entryBound(data) == BOUND_NONE ? INT32_MIN : entryDepth(data) - 8 * relativeAge;
+    if (value < worst) {
+      worst = value;
+      replace = &e;
+    }
+  }
+  uint64_t data = packEntry(move, score, depth, bound, age);
+  replace->check.store(key ^ data, memory_order_relaxed);
+  replace->data.store(data, memory_order_relaxed);
+}
+
+// permill of entries used by the current search, sampled
+int TranspositionTable::hashfull() const {
+  size_t samples = min<size_t>(buckets.size(), 250);
+  int used = 0;
+  for (size_t i = 0; i < samples; i++) {
+    for (auto& e : buckets[i].entries) {
+      uint64_t data = e.data.load(memory_order_relaxed);
+      if (entryBound(data) != BOUND_NONE && entryAge(data) == age) used++;
+    }
+  }
+  return samples ? used * 1000 / int(samples * BUCKET_SIZE) : 0;
+}
@@ -0,0 +1,210 @@
+#include "search.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+// lines are written by the input and the search thread
+mutex outputMutex;
+
+// write a line to the GUI at once
+void send(const string& line) {
+  lock_guard<mutex> lock(outputMutex);
+  cout << line << endl;
+}
+
+// convert a score to UCI, mates are given in moves instead of centipawns
+string scoreToString(int score) {
+  if (score >= MATE_BOUND) return "mate " + to_string((MATE - score + 1) / 2);
+  if (score <= -MATE_BOUND) return "mate " + to_string(-(MATE + score) / 2);
+  return "cp " + to_string(score);
+}
+
+// find the legal move given in coordinate notation, e.g. e2e4 or e7e8q
+Move parseMove(const Position& pos, const string& str) {
+  MoveList list;
+  generateLegalMoves(pos, list);
+  for (auto m : list) {
+    if (moveToString(m) == str) return m;
+  }
+  return NO_MOVE;
+}
+
+// set up the position of a "position" command
+void setPosition(Position& pos, istringstream& args) {
+  string token, fen;
+  args >> token;
+  if (token == "startpos") {
+    fen = START_FEN;
+    args >> token;
+  } else if (token == "fen") {
+    while (args >> token && token != "moves") fen += token + " ";
+  }
+  if (!pos.fromFEN(fen)) {
+    send("info string invalid fen " + fen);
+    pos.fromFEN(START_FEN);
+    return;
+  }
+  // token is "moves" now, if there are any
+  while (args >> token) {
+    Move m = parseMove(pos, token);
+    if (!m) {
+      send("info string illegal move " + token);
+      return;
+    }
+    pos.doMove(m);
+  }
+}
+
+// option names are not case sensitive
+string lowerCase(string str) {
+  for (auto& c : str) c = char(tolower((unsigned char)c));
+  return str;
+}
+
+// read the value of a spin option, clamped to its bounds; fails if it is
+// not a number
+bool parseSpin(const string& value, int low, int high, int& result) {
+  int n = 0;
+  auto end = value.data() + value.size();
+  auto [ptr, ec] = from_chars(value.data(), end, n);
+  if (ptr == value.data() || ptr != end) return false;
+  // a number out of the range of int is beyond the bounds as well
+  if (ec == errc::result_out_of_range) n = value[0] == '-' ? low : high;
+  result = clamp(n, low, high);
+  return true;
+}
+
+// limits of a "go" command; the time for a move is a share of the
+// remaining time of the player on turn, which is kept in reserve
+SearchLimits parseLimits(const Position& pos, istringstream& args, bool& infinite) {
+  SearchLimits limits;
+  int64_t time[2] = {0, 0};
+  int64_t inc[2] = {0, 0};
+  int movesToGo = 30;
+  infinite = false;
+  string token;
+  while (args >> token) {
+    if (token == "depth") args >> limits.depth;
+    else if (token == "nodes") args >> limits.nodes;
+    else if (token == "movetime") args >> limits.movetime;
+    else if (token == "wtime") args >> time[WHITE];
+    else if (token == "btime") args >> time[BLACK];
+    else if (token == "winc") args >> inc[WHITE];
+    else if (token == "binc") args >> inc[BLACK];
+    else if (token == "movestogo") args >> movesToGo;
+    else if (token == "infinite") infinite = true;
+  }
+  limits.depth = clamp(limits.depth, 1, MAX_PLY);
+  int us = pos.player ? WHITE : BLACK;
+  if (time[us] && !limits.movetime) {
+    int64_t share = time[us] / max(movesToGo, 1) + inc[us] / 2;
+    limits.movetime = max<int64_t>(1, min(share, time[us] - 50));
+  }
+  return limits;
+}
+
+int main() {
+  initBitboards();
+
+  Position pos(0);
+  pos.fromFEN(START_FEN);
+  TranspositionTable tt;
+  tt.resize(16);
+  int threads = 1;
+
+  // the search runs on its own thread, so the input is read while it runs
+  thread searcher;
+  atomic<bool> stop{false};
+  // an infinite search reports its move only after "stop"
+  atomic<bool> infinite{false};
+
+  // end a running search and wait for its move
+  auto waitSearch = [&]() {
+    if (!searcher.joinable()) return;
+    stop = true;
+    infinite = false;
+    infinite.notify_one();
+    searcher.join();
+  };
+
+  string line;
+  while (getline(cin, line)) {
+    istringstream args(line);
+    string command;
+    args >> command;
+    if (command == "uci") {
+      send("id name ThinkChess++");
+      send("id author ThinkChess++ developers");
+      send("option name Hash type spin default 16 min 1 max 65536");
+      send("option name Threads type spin default 1 min 1 max 256");
+      send("uciok");
+    } else if (command == "isready") {
+      send("readyok");
+    } else if (command == "setoption") {
+      // setoption name <name> value <value>, the name may contain spaces
+      string token, name, value;
+      args >> token;
+      while (args >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+      args >> value;
+      name = lowerCase(name);
+      waitSearch();
+      int n = 0;
+      if (name == "hash" && parseSpin(value, 1, 65536, n)) {
+        // a table too large for the memory keeps the old one
+        try {
+          tt.resize(n);
+        } catch (const bad_alloc&) {
+          send("info string not enough memory for hash " + value);
+        }
+      } else if (name == "threads" && parseSpin(value, 1, 256, n)) {
+        threads = n;
+      } else {
+        send("info string invalid option " + line);
+      }
+    } else if (command == "ucinewgame") {
+      waitSearch();
+      tt.clear(threads);
+    } else if (command == "position") {
+      waitSearch();
+      setPosition(pos, args);
+    } else if (command == "go") {
+      waitSearch();
+      bool forever = false;
+      SearchLimits limits = parseLimits(pos, args, forever);
+      stop = false;
+      infinite = forever;
+      searcher = thread([&, limits]() {
+        Search s(pos, &tt);
+        s.threads = threads;
+        s.abort = &stop;
+        s.report = [](const SearchResult& r) {
+          ostringstream info;
+          info << "info depth " << r.depth << " score " << scoreToString(r.score)
+               << " nodes " << r.nodes << " nps " << r.nodes * 1000 / max<int64_t>(r.time, 1)
+               << " time " << r.time << " pv";
+          for (auto m : r.pv) info << " " << moveToString(m);
+          send(info.str());
+        };
+        SearchResult result = s.run(limits);
+        infinite.wait(true);
+        send("bestmove " + (result.bestMove ? moveToString(result.bestMove) : "0000"));
+      });
+    } else if (command == "stop") {
+      waitSearch();
+    } else if (command == "quit") {
+      break;
+    }
+  }
+  waitSearch();
+  clearPosition(pos);
+  return 0;
+}
@@ -0,0 +1,31 @@
+#include "zobrist.hpp"
+
+using namespace std;
+
+uint64_t zobristPiece[2][6][64];
+uint64_t zobristSide;
+uint64_t zobristCastling[16];
+uint64_t zobristEp[8];
+
+// xorshift64* generator, the fixed seed keeps keys stable between runs
+uint64_t randomKey(uint64_t& seed) {
+  seed ^= seed >> 12;
+  seed ^= seed << 25;
+  seed ^= seed >> 27;
+  return seed * 2685821657736338717ULL;
+}
+
+// fill the keys with fixed pseudo random numbers
+void initZobrist() {
+  uint64_t seed = 1070372;
+  for (int color = 0; color < 2; color++) {
+    for (int type = 0; type < 6; type++) {
+      for (int sq = 0; sq < 64; sq++) {
+        zobristPiece[color][type][sq] = randomKey(seed);
+      }
+    }
+  }
+  zobristSide = randomKey(seed);
+  for (int i = 0; i < 16; i++) zobristCastling[i] = randomKey(seed);
+  for (int i = 0; i < 8; i++) zobristEp[i] = randomKey(seed);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "lockfree.hpp"
+#include "position.hpp"
+#include "search.hpp"
+#include "tt.hpp"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+using namespace std;
+
+// latest result of the analysis of a position
+struct AnalysisInfo {
+  // hash key of the position analyzed, to skip results of older positions
+  uint64_t key = 0;
+  // centipawns from white's view
+  int score = 0;
+  int depth = 0;
+  uint64_t nodes = 0;
+  // best line
+  Move pv[MAX_PLY];
+  int pvLength = 0;
+};
+
+// worker thread which searches the latest position it was given until a
+// newer one arrives; the positions come in through a lock-free queue and
+// the results of every completed iteration go out through a triple buffer,
+// so the drawing thread never waits for the search
+class Analyzer {
+public:
+  Analyzer(TranspositionTable& tt, int threads = 1);
+  ~Analyzer();
+
+  Analyzer(const Analyzer&) = delete;
+  Analyzer& operator=(const Analyzer&) = delete;
+
+  // stop the current search and analyze a copy of the position instead
+  void analyze(const Position& pos);
+
+  // stop the current search and wait for the next position
+  void stop();
+
+  // fetch the latest result if there is a new one since the last call
+  bool latest(AnalysisInfo& info) { return results.read(info); }
+
+private:
+  // search the incoming positions until the analyzer is destroyed
+  void work();
+
+  // positions to analyze, owned by the queue until taken by the worker;
+  // nullptr stops the analysis
+  SpscQueue<Position*, 16> snapshots;
+
+  // results of the analysis
+  TripleBuffer<AnalysisInfo> results;
+
+  // ends the current search when a newer position arrived
+  atomic<bool> interrupt{false};
+
+  // counts the positions sent, the worker sleeps on it when idle
+  atomic<uint32_t> signal{0};
+
+  // set to end the worker
+  atomic<bool> quit{false};
+
+  // table of the searches, used by the worker only
+  TranspositionTable& tt;
+
+  // threads per search
+  int threads;
+
+  thread worker;
+};
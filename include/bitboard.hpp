@@ -0,0 +1,128 @@
+#pragma once
+#include "pieces.hpp"
+#include <bit>
+#include <cstdint>
+#ifdef USE_PEXT
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// a set of squares with one bit per square, a1 = bit 0 ... h8 = bit 63
+typedef uint64_t Bitboard;
+
+// squares of the board, in bitboard order
+enum Square {
+  A1, B1, C1, D1, E1, F1, G1, H1,
+  A2, B2, C2, D2, E2, F2, G2, H2,
+  A3, B3, C3, D3, E3, F3, G3, H3,
+  A4, B4, C4, D4, E4, F4, G4, H4,
+  A5, B5, C5, D5, E5, F5, G5, H5,
+  A6, B6, C6, D6, E6, F6, G6, H6,
+  A7, B7, C7, D7, E7, F7, G7, H7,
+  A8, B8, C8, D8, E8, F8, G8, H8,
+  NO_SQUARE
+};
+
+// convert board coordinates (row 0 = rank 8) to a square
+constexpr int toSquare(int row, int col) { return (7 - row) * 8 + col; }
+
+// get the board row of a square
+constexpr int squareRow(int sq) { return 7 - sq / 8; }
+
+// get the board column of a square
+constexpr int squareCol(int sq) { return sq % 8; }
+
+// bitboard with only the given square set
+constexpr Bitboard squareBB(int sq) { return Bitboard(1) << sq; }
+
+// index of the least significant set bit
+inline int lsb(Bitboard b) { return countr_zero(b); }
+
+// remove the least significant set bit and return its index
+inline int popLsb(Bitboard& b) {
+  int sq = countr_zero(b);
+  b &= b - 1;
+  return sq;
+}
+
+// number of set bits
+inline int popCount(Bitboard b) { return popcount(b); }
+
+// lookup data for the attacks of a sliding piece on one square
+struct Magic {
+  Bitboard mask;
+  Bitboard magic;
+  Bitboard* attacks;
+  unsigned shift;
+
+  // index of the attack set for the given occupancy
+  unsigned index(Bitboard occupied) const {
+#ifdef USE_PEXT
+    return _pext_u64(occupied, mask);
+#else
+    return unsigned(((occupied & mask) * magic) >> shift);
+#endif
+  }
+};
+
+extern Magic rookMagics[64];
+extern Magic bishopMagics[64];
+
+// attacks of the leaping pieces, indexed by square
+extern Bitboard knightAttacks[64];
+extern Bitboard kingAttacks[64];
+
+// attacks of pawns, indexed by color and square
+extern Bitboard pawnAttacks[2][64];
+
+// squares strictly between two squares on a common line, else empty
+extern Bitboard betweenBB[64][64];
+
+// the whole line through two squares, else empty
+extern Bitboard lineBB[64][64];
+
+// build the attack tables, hash keys and piece square tables,
+// has to be called once at startup
+void initBitboards();
+
+// squares attacked by a rook on sq with the given occupancy
+inline Bitboard rookAttacks(int sq, Bitboard occupied) {
+  const Magic& m = rookMagics[sq];
+  return m.attacks[m.index(occupied)];
+}
+
+// squares attacked by a bishop on sq with the given occupancy
+inline Bitboard bishopAttacks(int sq, Bitboard occupied) {
+  const Magic& m = bishopMagics[sq];
+  return m.attacks[m.index(occupied)];
+}
+
+// squares attacked by a queen on sq with the given occupancy
+inline Bitboard queenAttacks(int sq, Bitboard occupied) {
+  return rookAttacks(sq, occupied) | bishopAttacks(sq, occupied);
+}
+
+// squares attacked by a piece of the given type on sq, chosen at compile
+// time so the move generation inlines it; pawn attacks depend on the
+// color and come from pawnAttacks instead
+template <PieceType Pt>
+inline Bitboard attacks(int sq, Bitboard occupied = 0) {
+  static_assert(Pt != PAWN, "pawn attacks depend on the color");
+  if constexpr (Pt == KNIGHT) return knightAttacks[sq];
+  else if constexpr (Pt == BISHOP) return bishopAttacks(sq, occupied);
+  else if constexpr (Pt == ROOK) return rookAttacks(sq, occupied);
+  else if constexpr (Pt == QUEEN) return queenAttacks(sq, occupied);
+  else return kingAttacks[sq];
+}
+
+// squares attacked by a piece of a type only known at run time
+inline Bitboard attacks(int pt, int sq, Bitboard occupied) {
+  switch (pt) {
+  case KNIGHT: return attacks<KNIGHT>(sq);
+  case BISHOP: return attacks<BISHOP>(sq, occupied);
+  case ROOK: return attacks<ROOK>(sq, occupied);
+  case QUEEN: return attacks<QUEEN>(sq, occupied);
+  default: return attacks<KING>(sq);
+  }
+}
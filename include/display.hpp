@@ -1,16 +1,33 @@
 #pragma once
 
+#include "gamestore.hpp"
 #include "position.hpp"
 #include <string>
-#include <filesystem>
 
 
-// get path for game to load
-std::filesystem::path getGame(int fn, std::filesystem::path games);
+// games listed on a page of the game loader
+const int GAMES_PER_PAGE = 10;
+
+// list a page of the games of a store for the game loader
+std::string listGames(const GameStore& store, uint64_t page);
+
+// read game n of a store, fails if its record, start position or one of its
+// moves is damaged
+bool readStoredGame(const GameStore& store, uint64_t n, PgnGame& game);
+
+// make a legal move of a stored game and mark check and mate for the display
+void playStoredMove(Position& pos, Move move);
+
+// moves history of a game read by readStoredGame, in the format of the game
+// files
+std::string gameHistory(const PgnGame& game);
 
 // reset board for new game
 void resetBoard(Position& pos);
 
+// set board to a position given in Forsyth-Edwards Notation
+bool setBoard(Position& pos, const std::string& fen);
+
 // calculates and returns the timer string
 std::string getTime(unsigned t);
 
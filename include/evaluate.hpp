@@ -0,0 +1,48 @@
+#pragma once
+
+#include "move.hpp"
+#include <cstdint>
+
+using namespace std;
+
+class Position;
+
+// middlegame and endgame score packed into one integer, the endgame value
+// in the upper 16 bits, so both are added and subtracted in one operation
+typedef int32_t Score;
+
+// pack a middlegame and an endgame value
+constexpr Score makeScore(int mg, int eg) {
+  return Score(uint32_t(eg) << 16) + mg;
+}
+
+// unpack the middlegame value
+constexpr int mgValue(Score s) { return int16_t(uint16_t(unsigned(s))); }
+
+// unpack the endgame value, rounding for a negative middlegame value
+constexpr int egValue(Score s) { return int16_t(uint16_t(unsigned(s + 0x8000) >> 16)); }
+
+// game phase of all pieces at the start, falls to 0 in a pawn endgame
+const int MAX_PHASE = 24;
+
+// contribution of each piece type to the game phase
+const int phaseWeight[6] = {0, 1, 1, 2, 4, 0};
+
+// material and placement of a piece, indexed by color, type and square,
+// positive for white and negative for black
+extern Score psqTable[2][6][64];
+
+// fill the piece square tables
+void initEvaluation();
+
+// evaluation for the player on turn: the network if one is loaded, else
+// the tapered piece square score
+int evaluate(const Position& pos);
+
+// piece values for exchanges, the king can never be captured
+const int seeValue[6] = {100, 300, 300, 500, 900, 20000};
+
+// static exchange evaluation: material won by the side making the move when
+// both sides keep capturing on the target square with their least valuable
+// piece and stop as soon as that would lose material
+int see(const Position& pos, Move move);
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "mappedfile.hpp"
+#include "pgn.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Games stored in one binary file, in little endian byte order:
+//   header:  "TCGS", uint32 version, uint64 game count, uint64 index offset,
+//            8 bytes reserved
+//   games:   uint16 length of white, black and fen, uint8 result,
+//            uint8 reserved, uint32 ply count, the three names, then the
+//            moves with 2 bytes each
+//   index:   uint64 offset of every game, at the index offset
+// Appending writes the new games behind the old index, then the index of all
+// games, and updates the header last, so a failed append keeps the old games.
+// The old index is left unused in the file.
+const uint32_t GAME_STORE_VERSION = 1;
+const size_t GAME_STORE_HEADER = 32;
+
+// write a number in little endian byte order
+void putNumber(unsigned char* p, uint64_t value, int bytes);
+
+// read a number in little endian byte order
+uint64_t getNumber(const unsigned char* p, int bytes);
+
+// results as stored, in the order of gameResults
+enum GameResult { RESULT_UNKNOWN, RESULT_WHITE, RESULT_BLACK, RESULT_DRAW };
+
+// notation of the results, indexed by GameResult
+const string_view gameResults[4] = {"*", "1-0", "0-1", "1/2-1/2"};
+
+// metadata of a stored game, read without decoding the moves
+struct GameInfo {
+  string_view white;
+  string_view black;
+  // start position, empty for the standard one
+  string_view fen;
+  int result = RESULT_UNKNOWN;
+  uint32_t plies = 0;
+};
+
+// read access to a game store; the file is mapped into memory and any
+// game is found through the index in constant time. A record is checked
+// against the file when it is read, so a damaged record fails on its own.
+class GameStore {
+public:
+  // open a store, fails if it is missing or its header is damaged
+  bool open(const string& path);
+
+  // unmap the file, e.g. before games are appended to it
+  void close() {
+    file.close();
+    count = 0;
+    index = nullptr;
+    gamesEnd = 0;
+  }
+
+  // number of games
+  uint64_t size() const { return count; }
+
+  // metadata of game n, counted from 0; the names point into the file.
+  // Fails if there is no such game or its record is damaged.
+  bool info(uint64_t n, GameInfo& info) const;
+
+  // the whole game n, counted from 0; fails like info
+  bool read(uint64_t n, PgnGame& game) const;
+
+private:
+  // start of the record of game n, nullptr if its fixed part is not within
+  // the games
+  const unsigned char* record(uint64_t n) const;
+
+  MappedFile file;
+  uint64_t count = 0;
+  const unsigned char* index = nullptr;
+  // the games lie between the header and this offset, where the index starts
+  uint64_t gamesEnd = 0;
+};
+
+// writes games to a new store or appends them to an existing one
+class GameStoreWriter {
+public:
+  ~GameStoreWriter() { close(); }
+
+  // create the store, or open it for appending if it exists
+  bool open(const string& path);
+
+  // write a game at the end of the store
+  void add(const PgnGame& game);
+
+  // write the index and the header, fails if anything was not written
+  bool close();
+
+private:
+  FILE* file = nullptr;
+  // offsets of all games, the old ones first
+  vector<uint64_t> offsets;
+  // where the next game goes
+  uint64_t end = GAME_STORE_HEADER;
+  bool failed = false;
+};
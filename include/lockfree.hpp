@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+using namespace std;
+
+// bounded ring buffer for exactly one producer and one consumer thread,
+// neither of them ever waits for a lock; N has to be a power of 2
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(N && (N & (N - 1)) == 0, "queue size must be a power of 2");
+
+public:
+  // append an item, fails if the queue is full, only the producer calls it
+  bool push(const T& item) {
+    size_t t = tail.load(memory_order_relaxed);
+    if (t - head.load(memory_order_acquire) == N) return false;
+    items[t & (N - 1)] = item;
+    tail.store(t + 1, memory_order_release);
+    return true;
+  }
+
+  // take the oldest item, fails if the queue is empty, only the consumer
+  // calls it
+  bool pop(T& item) {
+    size_t h = head.load(memory_order_relaxed);
+    if (h == tail.load(memory_order_acquire)) return false;
+    item = items[h & (N - 1)];
+    head.store(h + 1, memory_order_release);
+    return true;
+  }
+
+private:
+  // the counters only grow, the slot is the counter modulo N; each one
+  // gets its own cache line so the two threads do not slow each other down
+  alignas(64) atomic<size_t> head{0};
+  alignas(64) atomic<size_t> tail{0};
+  T items[N];
+};
+
+// latest value passed from one writer to one reader thread: the writer
+// fills its own slot and swaps it with the shared one, the reader swaps
+// the shared one with its own, so neither ever sees a half written value
+template <typename T>
+class TripleBuffer {
+public:
+  // the slot the writer fills before publishing it
+  T& back() { return slots[writing]; }
+
+  // make the filled slot the latest value, only the writer calls it
+  void publish() {
+    writing = shared.exchange(writing | FRESH, memory_order_acq_rel) & ~FRESH;
+  }
+
+  // fetch the latest value if one was published since the last call,
+  // only the reader calls it
+  bool read(T& value) {
+    if (!(shared.load(memory_order_relaxed) & FRESH)) return false;
+    reading = shared.exchange(reading, memory_order_acq_rel) & ~FRESH;
+    value = slots[reading];
+    return true;
+  }
+
+private:
+  // marks a shared slot which the reader has not seen yet
+  static const int FRESH = 4;
+
+  T slots[3];
+
+  // slot index of the writer, of the reader and the one in between
+  int writing = 0;
+  int reading = 1;
+  alignas(64) atomic<int> shared{2};
+};
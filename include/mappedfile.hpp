@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+// read-only view of a whole file in memory; the operating system loads
+// the pages when they are touched, so even huge files open instantly
+class MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // map the file, fails if it cannot be opened; sequential tells the
+  // operating system to read ahead, otherwise pages are read on demand
+  bool open(const string& path, bool sequential = true);
+
+  // unmap the file
+  void close();
+
+  // contents of the file, nullptr if it is empty
+  const char* data() const { return ptr; }
+  size_t size() const { return length; }
+
+private:
+  const char* ptr = nullptr;
+  size_t length = 0;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "pieces.hpp"
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// a move packed into 16 bits: from square (6), to square (6), flags (4)
+typedef uint16_t Move;
+
+// move flags, bit 2 marks captures and bit 3 promotions
+enum MoveFlag {
+  QUIET = 0, DOUBLE_PUSH = 1, KING_CASTLE = 2, QUEEN_CASTLE = 3,
+  CAPTURE = 4, EP_CAPTURE = 5,
+  PROMOTION = 8, PROMO_CAPTURE = 12
+};
+
+// the empty move
+const Move NO_MOVE = 0;
+
+// pack a move
+constexpr Move encodeMove(int from, int to, int flags) {
+  return Move(from | (to << 6) | (flags << 12));
+}
+
+// unpack a move
+constexpr int moveFrom(Move m) { return m & 0x3F; }
+constexpr int moveTo(Move m) { return (m >> 6) & 0x3F; }
+constexpr int moveFlags(Move m) { return m >> 12; }
+constexpr bool isCapture(Move m) { return m & (CAPTURE << 12); }
+constexpr bool isPromotion(Move m) { return m & (PROMOTION << 12); }
+
+// piece type a pawn is promoted to, the low flag bits count from knight
+constexpr int promotionType(Move m) { return KNIGHT + (moveFlags(m) & 3); }
+
+// convert a move to coordinate notation, e.g. e2e4 or e7e8q
+string moveToString(Move m);
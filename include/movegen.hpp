@@ -0,0 +1,44 @@
+#pragma once
+
+#include "move.hpp"
+#include "position.hpp"
+
+using namespace std;
+
+// maximum number of legal moves in any position is 218
+const int MAX_MOVES = 256;
+
+// fixed capacity list of moves, lives on the stack
+struct MoveList {
+  Move moves[MAX_MOVES];
+  int size = 0;
+
+  void add(Move m) { moves[size++] = m; }
+  Move* begin() { return moves; }
+  Move* end() { return moves + size; }
+  const Move* begin() const { return moves; }
+  const Move* end() const { return moves + size; }
+};
+
+// kinds of moves to generate, so the search can ask for them in stages
+enum GenType {
+  CAPTURES, // captures, en passant and all promotions
+  QUIETS,   // all other moves, including castling
+  ALL
+};
+
+// generate the legal moves of one kind for the player on turn, optionally
+// only those of the pieces on the given squares
+void generateMoves(const Position& pos, MoveList& list, GenType type,
+                   Bitboard sources = ~Bitboard(0));
+
+// generate all legal moves for the player on turn
+inline void generateLegalMoves(const Position& pos, MoveList& list) {
+  generateMoves(pos, list, ALL);
+}
+
+// test wether a move, e.g. from the hash table, is legal in the position
+bool isLegal(const Position& pos, Move move);
+
+// test wether a legal move gives check
+bool givesCheck(const Position& pos, Move move);
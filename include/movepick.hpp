@@ -0,0 +1,69 @@
+#pragma once
+
+#include "movegen.hpp"
+#include "position.hpp"
+
+using namespace std;
+
+// history scores are kept within this bound
+const int MAX_HISTORY = 1 << 14;
+
+// hands out the legal moves of a position in stages, most promising first:
+// the move from the table, captures by MVV-LVA, killers, the counter move,
+// and the quiet moves by their history score. A stage is only generated
+// when the one before is used up, so a cutoff by the table move or a
+// capture saves generating the quiet moves, and within a stage the next
+// move is selected when it is asked for instead of sorting the list.
+class MovePicker {
+public:
+  // moves for the main search
+  MovePicker(const Position& pos, Move ttMove, const Move killers[2],
+             Move counter, const int history[64][64]);
+
+  // moves for the quiescence search: captures and promotions, and the
+  // quiet moves which give check if asked for; all evasions in check
+  MovePicker(const Position& pos, Move ttMove, bool checks);
+
+  // the best remaining move, or NO_MOVE when all were handed out
+  Move next();
+
+private:
+  // stages, in the order they are gone through
+  enum Stage {
+    TT_MOVE, INIT_CAPTURES, CAPTURES_STAGE, REFUTATIONS, INIT_QUIETS, QUIETS_STAGE,
+    QS_TT_MOVE, QS_INIT_CAPTURES, QS_CAPTURES, QS_INIT_CHECKS, QS_CHECKS,
+    EVASION_TT_MOVE, INIT_EVASIONS, EVASIONS_STAGE, DONE
+  };
+
+  // score the captures by MVV-LVA
+  void scoreCaptures();
+
+  // score the quiet moves by their history
+  void scoreQuiets();
+
+  // score the evasions, captures first
+  void scoreEvasions();
+
+  // the best remaining move of the stage which is not handed out yet
+  Move selectBest();
+
+  // test wether a move was handed out before the current stage
+  bool handedOut(Move m) const;
+
+  const Position& pos;
+  Move ttMove;
+  Move refutations[3] = {NO_MOVE, NO_MOVE, NO_MOVE};
+  int refutationCount = 0;
+  const int (*history)[64] = nullptr;
+  bool checks = false;
+  int stage;
+  MoveList list;
+  int scores[MAX_MOVES];
+  int current = 0;
+};
+
+// add a bonus (or a penalty, if negative) to a history score, the score
+// moves less the closer it gets to the bound
+inline void updateHistory(int& entry, int bonus) {
+  entry += bonus - entry * abs(bonus) / MAX_HISTORY;
+}
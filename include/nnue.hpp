@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+class Position;
+
+// HalfKP inputs: the square of the own king times the square and type of
+// every other piece, kings excluded (64 * 64 * 10)
+const int NNUE_INPUTS = 64 * 64 * 10;
+
+// neurons of the first layer, for each side
+const int NNUE_HIDDEN = 256;
+
+// first layer outputs of both sides, the part of the network which is
+// updated incrementally when pieces are put on or removed from the board
+struct alignas(64) Accumulator {
+  int16_t values[2][NNUE_HIDDEN] = {};
+  // the king of that side moved, the values have to be recomputed
+  bool dirty[2] = {true, true};
+};
+
+// a network is loaded and used by evaluate()
+extern bool nnueEnabled;
+
+// load a network from a file, the hand written evaluation stays in use
+// if it cannot be read. The file holds, all little endian:
+//   "TCNN", uint32 version (1), uint32 inputs, uint32 hidden,
+//   int16 biases[hidden], int16 weights[inputs][hidden],
+//   int16 output weights[2 * hidden] (side on turn first), int32 output bias
+// and the score in centipawns is the output divided by 64
+bool loadNetwork(const string& path);
+
+// name of the SIMD kernels picked for this CPU: avx2, sse4.1 or scalar
+const char* nnueKernel();
+
+// add or remove the input of a piece, kings mark their side dirty instead
+void nnueUpdate(Accumulator& acc, const int kingSquare[2],
+                int color, int type, int sq, bool add);
+
+// evaluation of the network for the player on turn
+int evaluateNetwork(const Position& pos);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "move.hpp"
+#include "position.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// a game read from a PGN file, with its moves checked by the rules
+struct PgnGame {
+  string white;
+  string black;
+  // "1-0", "0-1", "1/2-1/2" or "*"
+  string result;
+  // start position, empty for the standard one
+  string fen;
+  vector<Move> moves;
+};
+
+// counts of an import
+struct PgnStats {
+  uint64_t games = 0;
+  uint64_t moves = 0;
+  // games skipped because of an illegal or unreadable move
+  uint64_t errors = 0;
+  uint64_t bytes = 0;
+};
+
+// find the legal move given in standard algebraic notation, e.g. Nbd7,
+// exd5, e8=Q or O-O; NO_MOVE if there is none or it is ambiguous
+Move parseSAN(const Position& pos, string_view san);
+
+// size of the chunks a PGN text is split into for the threads
+const size_t PGN_CHUNK_SIZE = 4 << 20;
+
+// read the games of a PGN text; it is split at game boundaries into
+// chunks of about PGN_CHUNK_SIZE, which are parsed by the given number of
+// threads, a few chunks ahead at most. The sink gets the valid games in
+// the order of the text, one call at a time.
+void importPGN(string_view text, int threads,
+               const function<void(PgnGame&)>& sink, PgnStats& stats);
+
+// read the games of a PGN file, which is mapped into memory; fails if the
+// file cannot be opened
+bool importPGN(const string& path, int threads,
+               const function<void(PgnGame&)>& sink, PgnStats& stats);
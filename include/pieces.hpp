@@ -1,155 +1,84 @@
 #pragma once
+#include <cstddef>
 #include <vector>
 
 using namespace std;
 
-// public interface for pieces
-class Piece {
-public:
-  virtual ~Piece() {}
-  virtual char getType() = 0;
-  virtual int getValue() = 0;
-  virtual bool isWhite() = 0;
-  virtual int getRow() = 0;
-  virtual int getCol() = 0;
-  virtual void makeMove(int r, int c) = 0;
-  virtual bool isValid(const vector<vector<Piece*>>& bd, int r, int c) = 0;
-};
+class Position;
 
+// piece types, used as index for the bitboards of a position
+enum PieceType { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
 
-class King : public Piece {
-public:
-  ~King() {}
-  King(bool w, int r, int c) :
-    type{'K'}, white{w}, value{0}, row{r}, col{c} {}
-
-  char getType() override { return type; }
-  int getValue() override { return value; }
-  bool isWhite() override { return white; }
-  int getRow() override { return row; }
-  int getCol() override { return col; }
-  void makeMove(int r, int c) override { row = r; col = c; }
-  bool isValid(const vector<vector<Piece*>>& bd, int r, int c) override;
-
-private:
-  char type;
-  bool white;
-  int value;
-  int row;
-  int col;
-};
-
-
-class Queen : public Piece {
-public:
-  ~Queen() {}
-  Queen(bool w, int r, int c) :
-    type{'Q'}, white{w}, value{900}, row{r}, col{c} {}
-
-  char getType() override { return type; }
-  int getValue() override { return value; }
-  bool isWhite() override { return white; }
-  int getRow() override { return row; }
-  int getCol() override { return col; }
-  void makeMove(int r, int c) override { row = r; col = c; }
-  bool isValid(const vector<vector<Piece*>>& bd, int r, int c) override;
-
-private:
-  char type;
-  bool white;
-  int value;
-  int row;
-  int col;
-};
+// colors, used as index for the bitboards of a position
+enum Color { WHITE, BLACK };
 
+// convert a piece letter to its piece type
+int pieceType(char type);
 
-class Rook : public Piece {
+// a piece on the board, a plain value so the engine reads its type and
+// color without virtual calls; the GUI uses it through the same accessors
+class Piece {
 public:
-  ~Rook() {}
-  Rook(bool w, int r, int c) :
-    type{'R'}, white{w}, value{500}, row{r}, col{c} {}
-
-  char getType() override { return type; }
-  int getValue() override { return value; }
-  bool isWhite() override { return white; }
-  int getRow() override { return row; }
-  int getCol() override { return col; }
-  void makeMove(int r, int c) override { row = r; col = c; }
-  bool isValid(const vector<vector<Piece*>>& bd, int r, int c) override;
+  Piece(int t, bool w, int r, int c) : type{t}, white{w}, row{r}, col{c} {}
+
+  // piece letter, e.g. 'N' for knights
+  char getType() const { return "PNBRQK"[type]; }
+  // piece type as PieceType, for indexing the bitboards
+  int getPieceType() const { return type; }
+  int getValue() const {
+    const int values[6] = {100, 300, 300, 500, 900, 0};
+    return values[type];
+  }
+  bool isWhite() const { return white; }
+  int getRow() const { return row; }
+  int getCol() const { return col; }
+  void makeMove(int r, int c) { row = r; col = c; }
+
+  // test wether the piece may move to the given field, regardless of checks
+  bool isValid(const Position& pos, int r, int c) const;
 
 private:
-  char type;
+  int type;
   bool white;
-  int value;
   int row;
   int col;
 };
 
-
-class Bishop : public Piece {
+// storage for the pieces of one position, so setting up a position and
+// making moves never allocates; a position has at most 32 pieces, on the
+// board and captured ones together
+class PiecePool {
 public:
-  ~Bishop() {}
-  Bishop(bool w, int r, int c) :
-    type{'B'}, white{w}, value{300}, row{r}, col{c} {}
-
-  char getType() override { return type; }
-  int getValue() override { return value; }
-  bool isWhite() override { return white; }
-  int getRow() override { return row; }
-  int getCol() override { return col; }
-  void makeMove(int r, int c) override { row = r; col = c; }
-  bool isValid(const vector<vector<Piece*>>& bd, int r, int c) override;
+  PiecePool() { reset(); }
 
-private:
-  char type;
-  bool white;
-  int value;
-  int row;
-  int col;
-};
+  // a copy starts empty, the copied position clones its pieces into it
+  PiecePool(const PiecePool&) : PiecePool() {}
+  PiecePool& operator=(const PiecePool&) {
+    reset();
+    return *this;
+  }
 
+  // create a piece of the given type, nullptr if the pool is full
+  Piece* create(int type, bool white, int row, int col);
 
-class Knight : public Piece {
-public:
-  ~Knight() {}
-  Knight(bool w, int r, int c) :
-    type{'N'}, white{w}, value{300}, row{r}, col{c} {}
-
-  char getType() override { return type; }
-  int getValue() override { return value; }
-  bool isWhite() override { return white; }
-  int getRow() override { return row; }
-  int getCol() override { return col; }
-  void makeMove(int r, int c) override { row = r; col = c; }
-  bool isValid(const vector<vector<Piece*>>& bd, int r, int c) override;
+  // destroy a piece of this pool and reuse its slot
+  void destroy(Piece* pc);
 
-private:
-  char type;
-  bool white;
-  int value;
-  int row;
-  int col;
-};
-
-
-class Pawn : public Piece {
-public:
-  ~Pawn() {}
-  Pawn(bool w, int r, int c) :
-    type{'P'}, white{w}, value{100}, row{r}, col{c} {}
-
-  char getType() override { return type; }
-  int getValue() override { return value; }
-  bool isWhite() override { return white; }
-  int getRow() override { return row; }
-  int getCol() override { return col; }
-  void makeMove(int r, int c) override { row = r; col = c; }
-  bool isValid(const vector<vector<Piece*>>& bd, int r, int c) override;
+  // number of pieces a pool holds
+  static const int SIZE = 32;
 
 private:
-  char type;
-  bool white;
-  int value;
-  int row;
-  int col;
+  // mark all slots as free
+  void reset() {
+    for (int i = 0; i < SIZE; i++) freeSlots[i] = SIZE - 1 - i;
+    freeCount = SIZE;
+  }
+
+  // raw storage, the pieces are created in it when needed
+  static const size_t SLOT = sizeof(Piece);
+  alignas(Piece) unsigned char storage[SIZE][SLOT];
+
+  // indexes of the unused slots, used as a stack
+  unsigned char freeSlots[SIZE];
+  int freeCount;
 };
@@ -1,12 +1,22 @@
 #pragma once
 
+#include "bitboard.hpp"
+#include "evaluate.hpp"
+#include "move.hpp"
+#include "nnue.hpp"
 #include "pieces.hpp"
+#include "zobrist.hpp"
+#include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <utility>
 
 using namespace std;
 
+class TranspositionTable;
+
 // convert columns to files
 char colToFile(int col);
 
@@ -22,456 +32,266 @@ int rankToRow(char rank);
 // get board coordinates
 pair<int, int> getField(int x, int y);
 
-// convert board coordinates to moves notation
-string convertFromBoard(bool cap, Piece* from, pair<int, int> to);
+// convert a move of a piece type to moves notation, e.g. Ng1-f3
+string convertFromBoard(Move move, char type);
 
 // test for check
-bool check(const vector<vector<Piece*>>& bd, bool white);
+bool check(const Position& pos, bool white);
 
 // check wether a given check can be resolved
-bool resolveCheck(vector<vector<Piece*>>& bd, bool player);
+bool resolveCheck(Position& pos, bool player);
 
 // evaluate board
-pair<int, int> evaluateBoard(const vector<vector<Piece*>>& bd);
-
-// parse move string and return coordinates
-vector<int> parseMove(string move);
+pair<int, int> evaluateBoard(const Position& pos);
 
 // print board for debug
-void printBoard(const vector<vector<Piece*>>& bd);
+void printBoard(const Position& pos);
+
+// copy a position with its own pieces, e.g. for another search thread
+void copyPosition(Position& dst, const Position& src);
+
+// remove all pieces of a position, including the captured ones
+void clearPosition(Position& pos);
+
+// Forsyth-Edwards Notation of the start position
+constexpr string_view START_FEN =
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// half moves the history of a position holds without growing
+const int MAX_GAME_PLY = 512;
+
+// size of a buffer large enough for any FEN written by toFEN
+const int FEN_SIZE = 96;
+
+// castling rights: 1 = white kingside, 2 = white queenside,
+// 4 = black kingside, 8 = black queenside
+enum CastlingRight {
+  WHITE_OO = 1, WHITE_OOO = 2, BLACK_OO = 4, BLACK_OOO = 8,
+  ALL_CASTLING = 15
+};
+
+// castling rights which remain after a piece moved from or to a square
+inline short castlingMask(int sq) {
+  switch (sq) {
+  case E1: return ALL_CASTLING & ~(WHITE_OO | WHITE_OOO);
+  case H1: return ALL_CASTLING & ~WHITE_OO;
+  case A1: return ALL_CASTLING & ~WHITE_OOO;
+  case E8: return ALL_CASTLING & ~(BLACK_OO | BLACK_OOO);
+  case H8: return ALL_CASTLING & ~BLACK_OO;
+  case A8: return ALL_CASTLING & ~BLACK_OOO;
+  default: return ALL_CASTLING;
+  }
+}
+
+// what a move destroyed, saved for taking back moves
+struct State {
+  Piece* captured;
+  short castlingRights;
+  int epSquare;
+  int halfmoveClock;
+  Bitboard checkers;
+  uint64_t key;
+};
 
 
 class Position {
 public:
   ~Position() {}
   Position(short gs) : gamestate{gs}, player{true},
-               board{8, vector<Piece*>(8)},
-               mvCount{0}, castled{0}, checkmate{-1, -1},
-               checked{false}, eval{0.f}
-  {}
+               pieces{}, colors{}, occupied{0}, squares{},
+               kingSquare{NO_SQUARE, NO_SQUARE}, checkers{0}, key{0},
+               psq{0}, phase{0}, acc{},
+               castlingRights{0}, epSquare{NO_SQUARE}, halfmoveClock{0},
+               mvCount{0}, startPly{0}, checkmate{-1, -1},
+               checked{false}, eval{0.f}, tt{nullptr}
+  {
+    // room for long games, so making moves does not grow the history
+    moves.reserve(MAX_GAME_PLY);
+    states.reserve(MAX_GAME_PLY);
+  }
 
-  // returns a material evaluation for both players
-  void evaluate() {
-    pair<int, int> matEval = evaluateBoard(board);
-    eval = float(matEval.first) / 100
-         - float(matEval.second) / 100;
+  // returns the piece on the given field or nullptr
+  Piece* pieceAt(int row, int col) const {
+    return squares[toSquare(row, col)];
   }
 
-  // test wether castling is possible
-  char castling(Piece* king, pair<int, int> to) {
-    if (check(board, king->isWhite())) return 'N'; // king is in check
-    string history;
-    for (auto mv : moves) {
-      history += mv;
-    }
-    if (king->isWhite()) { // white
-      auto pos = history.find("Ke1");
-      if (pos != std::string::npos) return 'N'; // king has moved
-      if (king->getRow() == 7 && king->getCol() == 4) {
-        if (to.first == 7 && to.second == 6) { // kingside
-          auto rook = board[7][7];
-          if (!rook || rook->getType() != 'R' || rook->isWhite() != king->isWhite()) {
-            return 'N'; // no rook
-          } else {
-            auto pos = history.find("Rh1");
-            if (pos != std::string::npos) return 'N'; // rook has moved
-          }
-          auto pc1 = board[7][5];
-          auto pc2 = board[7][6];
-          if (pc1 || pc2) return 'N'; // fields occupied
-          else {
-            // test for check
-            board[7][5] = king;
-            king->makeMove(7, 5);
-            if (check(board, king->isWhite())) {
-              board[7][4] = king;
-              king->makeMove(7, 4);
-              board[7][5] = nullptr;
-              return 'N';
-            } else {
-              board[7][4] = king;
-              king->makeMove(7, 4);
-              board[7][5] = nullptr;
-            }
-            board[7][6] = king;
-            king->makeMove(7, 6);
-            if (check(board, king->isWhite())) {
-              board[7][4] = king;
-              king->makeMove(7, 4);
-              board[7][6] = nullptr;
-              return 'N';
-            } else {
-              board[7][4] = king;
-              king->makeMove(7, 4);
-              board[7][6] = nullptr;
-            }
-            return 'K';
-          }
-        } else if (to.first == 7 && to.second == 2) { // queenside
-          auto rook = board[7][0];
-          if (!rook || rook->getType() != 'R' || rook->isWhite() != king->isWhite()) {
-            return 'N'; // no rook
-          } else {
-            auto pos = history.find("Ra1");
-            if (pos != std::string::npos) return 'N'; // rook has moved
-          }
-          auto pc1 = board[7][1];
-          auto pc2 = board[7][2];
-          auto pc3 = board[7][3];
-          if (pc1 || pc2 || pc3) return 'N'; // fields occupied
-          else {
-            // test for check
-            board[7][3] = king;
-            king->makeMove(7, 3);
-            if (check(board, king->isWhite())) {
-              board[7][4] = king;
-              king->makeMove(7, 4);
-              board[7][3] = nullptr;
-              return 'N';
-            } else {
-              board[7][4] = king;
-              king->makeMove(7, 4);
-              board[7][3] = nullptr;
-            }
-            board[7][2] = king;
-            king->makeMove(7, 2);
-            if (check(board, king->isWhite())) {
-              board[7][4] = king;
-              king->makeMove(7, 4);
-              board[7][2] = nullptr;
-              return 'N';
-            } else {
-              board[7][4] = king;
-              king->makeMove(7, 4);
-              board[7][2] = nullptr;
-            }
-            return 'Q';
-          }
-        }
-      }
-    } else { // black
-      auto pos = history.find("Ke8");
-      if (pos != std::string::npos) return 'N'; // king has moved
-      if (king->getRow() == 0 && king->getCol() == 4) {
-        if (to.first == 0 && to.second == 6) { // kingside
-          auto rook = board[0][7];
-          if (!rook || rook->getType() != 'R' || rook->isWhite() != king->isWhite()) {
-            return 'N'; // no rook
-          } else {
-            auto pos = history.find("Rh8");
-            if (pos != std::string::npos) return 'N'; // rook has moved
-          }
-          auto pc1 = board[0][5];
-          auto pc2 = board[0][6];
-          if (pc1 || pc2) return 'N'; // fields occupied
-          else {
-            // test for check
-            board[0][5] = king;
-            king->makeMove(0, 5);
-            if (check(board, king->isWhite())) {
-              board[0][4] = king;
-              king->makeMove(0, 4);
-              board[0][5] = nullptr;
-              return 'N';
-            } else {
-              board[0][4] = king;
-              king->makeMove(0, 4);
-              board[0][5] = nullptr;
-            }
-            board[0][6] = king;
-            king->makeMove(0, 6);
-            if (check(board, king->isWhite())) {
-              board[0][4] = king;
-              king->makeMove(0, 4);
-              board[0][6] = nullptr;
-              return 'N';
-            } else {
-              board[0][4] = king;
-              king->makeMove(0, 4);
-              board[0][6] = nullptr;
-            }
-            return 'K';
-          }
-        } else if (to.first == 0 && to.second == 2) { // queenside
-          auto rook = board[0][0];
-          if (!rook || rook->getType() != 'R' || rook->isWhite() != king->isWhite()) {
-            return 'N'; // no rook
-          } else {
-            auto pos = history.find("Ra8");
-            if (pos != std::string::npos) return 'N'; // rook has moved
-          }
-          auto pc1 = board[0][1];
-          auto pc2 = board[0][2];
-          auto pc3 = board[0][3];
-          if (pc1 || pc2 || pc3) return 'N'; // fields occupied
-          else {
-            // test for check
-            board[0][3] = king;
-            king->makeMove(0, 3);
-            if (check(board, king->isWhite())) {
-              board[0][4] = king;
-              king->makeMove(0, 4);
-              board[0][3] = nullptr;
-              return 'N';
-            } else {
-              board[0][4] = king;
-              king->makeMove(0, 4);
-              board[0][3] = nullptr;
-            }
-            board[0][2] = king;
-            king->makeMove(0, 2);
-            if (check(board, king->isWhite())) {
-              board[0][4] = king;
-              king->makeMove(0, 4);
-              board[0][2] = nullptr;
-              return 'N';
-            } else {
-              board[0][4] = king;
-              king->makeMove(0, 4);
-              board[0][2] = nullptr;
-            }
-            return 'Q';
-          }
-        }
+  // test wether the given field is occupied
+  bool isOccupied(int row, int col) const {
+    return occupied & squareBB(toSquare(row, col));
+  }
+
+  // put a piece on the board at its own coordinates
+  void putPiece(Piece* pc) {
+    int sq = toSquare(pc->getRow(), pc->getCol());
+    int color = pc->isWhite() ? WHITE : BLACK;
+    int type = pc->getPieceType();
+    pieces[color][type] |= squareBB(sq);
+    colors[color] |= squareBB(sq);
+    occupied |= squareBB(sq);
+    squares[sq] = pc;
+    key ^= zobristPiece[color][type][sq];
+    psq += psqTable[color][type][sq];
+    phase += phaseWeight[type];
+    if (nnueEnabled) nnueUpdate(acc, kingSquare, color, type, sq, true);
+    if (type == KING) kingSquare[color] = sq;
+  }
+
+  // remove the piece from a square and return it
+  Piece* removePiece(int sq) {
+    auto pc = squares[sq];
+    if (!pc) return nullptr;
+    int color = pc->isWhite() ? WHITE : BLACK;
+    int type = pc->getPieceType();
+    pieces[color][type] &= ~squareBB(sq);
+    colors[color] &= ~squareBB(sq);
+    occupied &= ~squareBB(sq);
+    squares[sq] = nullptr;
+    key ^= zobristPiece[color][type][sq];
+    psq -= psqTable[color][type][sq];
+    phase -= phaseWeight[type];
+    if (nnueEnabled) nnueUpdate(acc, kingSquare, color, type, sq, false);
+    return pc;
+  }
+
+  // move a piece to an empty square
+  void movePiece(int from, int to) {
+    auto pc = removePiece(from);
+    pc->makeMove(squareRow(to), squareCol(to));
+    putPiece(pc);
+  }
+
+  // pieces of both colors attacking a square, for the given occupancy
+  Bitboard attackersTo(int sq, Bitboard occ) const {
+    return (pawnAttacks[BLACK][sq] & pieces[WHITE][PAWN])
+         | (pawnAttacks[WHITE][sq] & pieces[BLACK][PAWN])
+         | (attacks<KNIGHT>(sq) & (pieces[WHITE][KNIGHT] | pieces[BLACK][KNIGHT]))
+         | (attacks<KING>(sq) & (pieces[WHITE][KING] | pieces[BLACK][KING]))
+         | (attacks<BISHOP>(sq, occ) & (pieces[WHITE][BISHOP] | pieces[BLACK][BISHOP]
+                                       | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN]))
+         | (attacks<ROOK>(sq, occ) & (pieces[WHITE][ROOK] | pieces[BLACK][ROOK]
+                                     | pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN]));
+  }
+
+  // test wether a square is attacked by the given color
+  bool isAttacked(int sq, int color) const {
+    const Bitboard* bb = pieces[color];
+    return (pawnAttacks[color ^ 1][sq] & bb[PAWN])
+        || (attacks<KNIGHT>(sq) & bb[KNIGHT])
+        || (attacks<KING>(sq) & bb[KING])
+        || (attacks<BISHOP>(sq, occupied) & (bb[BISHOP] | bb[QUEEN]))
+        || (attacks<ROOK>(sq, occupied) & (bb[ROOK] | bb[QUEEN]));
+  }
+
+  // find the pieces giving check to the player on turn
+  void updateCheckers() {
+    int us = player ? WHITE : BLACK;
+    checkers = attackersTo(kingSquare[us], occupied) & colors[us ^ 1];
+  }
+
+  // hash key of the position computed from scratch, for setup and debugging
+  uint64_t computeKey() const {
+    uint64_t k = 0;
+    for (int color = WHITE; color <= BLACK; color++) {
+      for (int type = PAWN; type <= KING; type++) {
+        Bitboard bb = pieces[color][type];
+        while (bb) k ^= zobristPiece[color][type][popLsb(bb)];
       }
     }
-    return 'N';
+    if (!player) k ^= zobristSide;
+    k ^= zobristCastling[castlingRights];
+    if (epSquare != NO_SQUARE) k ^= zobristEp[squareCol(epSquare)];
+    return k;
   }
 
-  // make next move from history
-  bool makeNext(string move) {
-    if (move.back() == '+') {
-      checked = true;
-      moves.push_back(move);
-      mvCount++;
-      move.pop_back();
-    } else {
-      checked = false;
-      moves.push_back(move);
-      mvCount++;
-    }
-    if (move.back() == '#') {
-      moves.push_back(move);
-      mvCount++;
-      move.pop_back();
-      vector<int> coords = parseMove(move);
-      checkmate = make_pair(coords[4], coords[3]);
-    }
-    // castling
-    if (move.back() == '0') {
-      char form;
-      move == "0-0" ? form = 'K' : form = 'Q';
-      bool white = (mvCount % 2 == 1);
-      if (white && form == 'K') {
-        board[7][6] = new King(1,7,6);
-        delete board[7][4];
-        board[7][4] = nullptr;
-        board[7][5] = new Rook(1,7,5);
-        delete board[7][7];
-        board[7][7] = nullptr;
-        castled == 0 ? castled = 1 : castled = 3;
-      }
-      if (white && form == 'Q') {
-        board[7][2] = new King(1,7,2);
-        delete board[7][4];
-        board[7][4] = nullptr;
-        board[7][3] = new Rook(1,7,3);
-        delete board[7][0];
-        board[7][0] = nullptr;
-        castled == 0 ? castled = 1 : castled = 3;
-      }
-      if (!white && form == 'K') {
-        board[0][6] = new King(0,0,6);
-        delete board[0][4];
-        board[0][4] = nullptr;
-        board[0][5] = new Rook(0,0,5);
-        delete board[0][7];
-        board[0][7] = nullptr;
-        castled == 0 ? castled = 2 : castled = 3;
-      }
-      if (!white && form == 'Q') {
-        board[0][2] = new King(0,0,2);
-        delete board[0][4];
-        board[0][4] = nullptr;
-        board[0][3] = new Rook(0,0,3);
-        delete board[0][0];
-        board[0][0] = nullptr;
-        castled == 0 ? castled = 2 : castled = 3;
-      }
-      return true;
-    } // end castling
-    // en passant
-    if (move.back() == 'p' && move[move.size()-2] == 'e') {
-      move.pop_back();
-      move.pop_back();
-      vector<int> coords = parseMove(move);
-      auto from = board[coords[1]][coords[0]];
-      if (!from) {
-        info = "no piece to move";
-        moves.pop_back();
-        mvCount--;
-        return false;
-      }
-      bool white = (mvCount % 2 == 1);
-      Piece* cp;
-      if (white) {
-        cp = board[coords[4]+1][coords[3]];
-        board[coords[4]+1][coords[3]] = nullptr;
-      } else {
-        cp = board[coords[4]-1][coords[3]];
-        board[coords[4]-1][coords[3]] = nullptr;
+  // piece square score computed from scratch, for debugging
+  Score computePsq() const {
+    Score score = 0;
+    for (int color = WHITE; color <= BLACK; color++) {
+      for (int type = PAWN; type <= KING; type++) {
+        Bitboard bb = pieces[color][type];
+        while (bb) score += psqTable[color][type][popLsb(bb)];
       }
-      if (cp) {
-        captured.push_back(cp);
-      } else {
-        info = "no piece to capture";
-        moves.pop_back();
-        mvCount--;
-        return false;
-      }
-      board[coords[4]][coords[3]] = from;
-      from->makeMove(coords[4], coords[3]);
-      board[coords[1]][coords[0]] = nullptr;
-      return true;
-    } // end en passant
-    vector<int> coords = parseMove(move);
-    auto from = board[coords[1]][coords[0]];
-    if (!from) {
-      info = "no piece to move";
-      moves.pop_back();
-      mvCount--;
-      return false;
     }
-    auto to = board[coords[4]][coords[3]];
-    if (coords[2]) { // capture
-      if (to) {
-        captured.push_back(to);
-      } else {
-        info = "no piece to capture";
-        moves.pop_back();
-        mvCount--;
-        return false;
-      }
+    return score;
+  }
+
+  // set up the position given in Forsyth-Edwards Notation, the missing
+  // fields at the end default to white on turn and no rights; returns
+  // false if the notation is invalid
+  bool fromFEN(string_view fen);
+
+  // write the position in Forsyth-Edwards Notation with a terminating
+  // zero to a buffer of FEN_SIZE chars, returns the length
+  int toFEN(char* buf) const;
+
+  // make a legal move and push it on the history
+  void doMove(Move m);
+
+  // take back the last move of the history
+  void undoMove();
+
+  // notation of the last move, produced on demand for display and files
+  string lastMove() const {
+    Move move = moves.back();
+    char type = isPromotion(move) ? 'P' : squares[moveTo(move)]->getType();
+    string notation = convertFromBoard(move, type);
+    if (checkmate.first != -1) notation.append(1, '#');
+    else if (checkers) notation.append(1, '+');
+    return notation;
+  }
+
+  // static evaluation in pawns from white's view
+  void evaluate() {
+    int score = ::evaluate(*this);
+    eval = float(player ? score : -score) / 100;
+  }
+
+  // test wether castling with the given right is legal for the player on turn
+  bool canCastle(int right) const {
+    if (!(castlingRights & right) || checkers) return false;
+    bool white = right & (WHITE_OO | WHITE_OOO);
+    int them = white ? BLACK : WHITE;
+    int rank = white ? 0 : 56;
+    if (right & (WHITE_OO | BLACK_OO)) { // kingside
+      Bitboard path = squareBB(F1 + rank) | squareBB(G1 + rank);
+      return !(occupied & path)
+          && !isAttacked(F1 + rank, them) && !isAttacked(G1 + rank, them);
+    } else { // queenside
+      Bitboard path = squareBB(B1 + rank) | squareBB(C1 + rank) | squareBB(D1 + rank);
+      return !(occupied & path)
+          && !isAttacked(D1 + rank, them) && !isAttacked(C1 + rank, them);
     }
-    // promotion
-    if (move.back() == 'Q') {
-      bool white = coords[4] == 0;
-      from = new Queen(white, coords[4], coords[3]);
+  }
+
+  // test wether castling is possible
+  char castling(Piece* king, pair<int, int> to) {
+    bool white = king->isWhite();
+    int row = white ? 7 : 0;
+    if (king->getRow() != row || king->getCol() != 4 || to.first != row) {
+      return 'N';
     }
-    board[coords[4]][coords[3]] = from;
-    from->makeMove(coords[4], coords[3]);
-    board[coords[1]][coords[0]] = nullptr;
-    return true;
+    if (to.second == 6 && canCastle(white ? WHITE_OO : BLACK_OO)) return 'K';
+    if (to.second == 2 && canCastle(white ? WHITE_OOO : BLACK_OOO)) return 'Q';
+    return 'N';
   }
 
+  // make next move from history
+  bool makeNext(string move);
+
   // take back last move
   bool takeBackMove() {
-    string move;
-    if (moves.size() > 0) {
-      move = moves.back();
-      moves.pop_back();
-      mvCount--;
-    } else return false;
-    // castling
-    if (move.back() == '0' || move[move.size()-2] == '0') {
-      if (move.back() == '+') move.pop_back();
-      char form;
-      move == "0-0" ? form = 'K' : form = 'Q';
-      bool white = (mvCount % 2 == 0);
-      if (white && form == 'K') {
-        board[7][4] = board[7][6];
-        board[7][6] = nullptr;
-        auto king = board[7][4];
-        king->makeMove(7, 4);
-        board[7][7] = board[7][5];
-        board[7][5] = nullptr;
-        auto rook = board[7][7];
-        rook->makeMove(7, 7);
-        castled == 1 ? castled = 0 : castled = 2;
-      }
-      if (white && form == 'Q') {
-        board[7][4] = board[7][2];
-        board[7][2] = nullptr;
-        auto king = board[7][4];
-        king->makeMove(7, 4);
-        board[7][0] = board[7][3];
-        board[7][3] = nullptr;
-        auto rook = board[7][0];
-        rook->makeMove(7, 0);
-        castled == 1 ? castled = 0 : castled = 2;
-      }
-      if (!white && form == 'K') {
-        board[0][4] = board[0][6];
-        board[0][6] = nullptr;
-        auto king = board[0][4];
-        king->makeMove(0, 4);
-        board[0][7] = board[0][5];
-        board[0][5] = nullptr;
-        auto rook = board[0][7];
-        rook->makeMove(0, 7);
-        castled == 2 ? castled = 0 : castled = 1;
-      }
-      if (!white && form == 'Q') {
-        board[0][4] = board[0][2];
-        board[0][2] = nullptr;
-        auto king = board[0][4];
-        king->makeMove(0, 4);
-        board[0][0] = board[0][3];
-        board[0][3] = nullptr;
-        auto rook = board[0][0];
-        rook->makeMove(0, 0);
-        castled == 2 ? castled = 0 : castled = 1;
-      }
-      player = !player;
-      return true;
-    }
-    // en passant
-    if (move.back() == 'p' && move[move.size()-2] == 'e') {
-      move.pop_back();
-      move.pop_back();
-      vector<int> coords = parseMove(move);
-      auto pc = board[coords[4]][coords[3]];
-      board[coords[4]][coords[3]] = nullptr;
-      board[coords[1]][coords[0]] = pc;
-      pc->makeMove(coords[1], coords[0]);
-      auto cp = captured.back();
-      captured.pop_back();
-      bool white = (mvCount % 2 == 0);
-      if (white) {
-        board[coords[4]+1][coords[3]] = cp;
-      } else {
-        board[coords[4]-1][coords[3]] = cp;
-      }
-      player = !player;
-      return true;
-    }
-    vector<int> coords = parseMove(move);
-    auto pc = board[coords[4]][coords[3]];
-    // promotion
-    if (move.back() == 'Q' || move[move.size()-2] == 'Q') {
-      bool white = coords[4] == 0;
-      pc = new Pawn(white, coords[1], coords[0]);
-    }
-    board[coords[1]][coords[0]] = pc;
-    pc->makeMove(coords[1], coords[0]);
-    if (coords[2] == 0) { // normal move
-      board[coords[4]][coords[3]] = nullptr;
-    } else { // captured
-      auto cp = captured.back();
-      board[coords[4]][coords[3]] = cp;
-      captured.pop_back();
-    }
-    player = !player;
+    if (moves.empty()) return false;
+    undoMove();
     return true;
   }
 
   // make a move
   bool makeMove(pair<int, int> from, pair<int, int> to) {
-    auto pcf = board[from.first][from.second];
-    auto pct = board[to.first][to.second];
-    bool cap = false;
-    bool prom = false;
-    bool passant = false;
+    auto pcf = pieceAt(from.first, from.second);
+    auto pct = pieceAt(to.first, to.second);
+    int sqf = toSquare(from.first, from.second);
+    int sqt = toSquare(to.first, to.second);
+    Move move = NO_MOVE;
 
     if (!pcf) {
       info = "no piece selected";
@@ -483,208 +303,116 @@ public:
     }
 
     // castling
-    short cast = player ? 1 : 2;
-    if (castled < 3 && castled != cast && pcf->getType() == 'K' && !pct) {
-      string move = "";
+    if (pcf->getType() == 'K' && !pct) {
       char form = castling(pcf, to);
-      if (form == 'K') {
-        castled = castled > 0 ? 3 : cast;
-        move = "0-0";
-        // make king move
-        board[from.first][from.second+2] = pcf;
-        pcf->makeMove(from.first, from.second+2);
-        board[from.first][from.second] = nullptr;
-        // make rook move
-        auto rook = board[from.first][7];
-        board[from.first][from.second+1] = rook;
-        rook->makeMove(from.first, from.second+1);
-        board[from.first][7] = nullptr;
-        if (check(board, !player)) { // gives opponent check
-          if (resolveCheck(board, !player)) {
-            move.append(1, '+');
-            checked = true;
-          } else { // cannot get out of check
-            move.append(1, '#');
-            moves.push_back(move);
-            checkmate = to;
-            mvCount++;
-            return true;
-          }
-        }
-        // complete move
-        moves.push_back(move);
-        player = !player;
-        mvCount++;
-        return true;
-      } else if (form == 'Q') {
-        castled = castled > 0 ? 3 : cast;
-        move = "0-0-0";
-        // make king move
-        board[from.first][from.second-2] = pcf;
-        pcf->makeMove(from.first, from.second-2);
-        board[from.first][from.second] = nullptr;
-        // make rook move
-        auto rook = board[from.first][0];
-        board[from.first][from.second-1] = rook;
-        rook->makeMove(from.first, from.second-1);
-        board[from.first][0] = nullptr;
-        if (check(board, !player)) { // gives opponent check
-          if (resolveCheck(board, !player)) {
-            move.append(1, '+');
-            checked = true;
-          } else { // cannot get out of check
-            move.append(1, '#');
-            moves.push_back(move);
-            checkmate = to;
-            mvCount++;
-            return true;
-          }
-        }
-        // complete move
-        moves.push_back(move);
-        player = !player;
-        mvCount++;
-        return true;
-      }
+      if (form == 'K') move = encodeMove(sqf, sqt, KING_CASTLE);
+      if (form == 'Q') move = encodeMove(sqf, sqt, QUEEN_CASTLE);
     } // end castling
 
     // valid move?
-    if (pcf->isValid(board, to.first, to.second)) {
+    if (!move) {
+      if (!pcf->isValid(*this, to.first, to.second)) {
+        info = "illegal move";
+        return false;
+      }
+      int flags = QUIET;
       // can capture?
       if (pct && pct->isWhite() != pcf->isWhite()) {
-        cap = true;
-        captured.push_back(pct);
+        flags = CAPTURE;
       } else if (pct) { // same color
         info = "illegal move";
         return false;
       }
-
-      // en passant
-      if (pcf && pcf->getType() == 'P') {
-        if (pcf->isWhite() && pcf->getRow() == 3) { // white
-          if (!pct) {
-            auto pawn = board[pcf->getRow()][to.second];
-            if (pawn && pawn->getType() == 'P' && pawn->isWhite() != player) {
-              string lastMove = moves.back();
-              pair<int, int> epTo = make_pair(pawn->getRow(), pawn->getCol());
-              auto epPc = new Pawn(!player, 1, to.second);
-              string ep = convertFromBoard(false, epPc, epTo);
-              delete epPc;
-              if (ep != lastMove) {
-                info = "illegal move";
-                return false;
-              } else {
-                passant = true;
-                cap = true;
-                captured.push_back(pawn);
-                board[pcf->getRow()][to.second] = nullptr;
-              }
-            }
-          }
-        } else if (!pcf->isWhite() && pcf->getRow() == 4) { // black
-          if (!pct) {
-            auto pawn = board[pcf->getRow()][to.second];
-            if (pawn && pawn->getType() == 'P' && pawn->isWhite() != player) {
-              string lastMove = moves.back();
-              pair<int, int> epTo = make_pair(pawn->getRow(), pawn->getCol());
-              auto epPc = new Pawn(!player, 6, to.second);
-              string ep = convertFromBoard(false, epPc, epTo);
-              delete epPc;
-              if (ep != lastMove) {
-                info = "illegal move";
-                return false;
-              } else {
-                passant = true;
-                cap = true;
-                captured.push_back(pawn);
-                board[pcf->getRow()][to.second] = nullptr;
-              }
-            }
-          }
-        }
-      } // end en passant
-
-      string move = convertFromBoard(cap, pcf, to);
-      if (passant) move.append("ep");
-
-      // promotion
-      if (pcf && pcf->getType() == 'P') {
-        if (pcf->isWhite() && pcf->getRow() == 1) { // white
-          pcf = new Queen(1, pcf->getRow(), pcf->getCol());
-          move.append("=Q");
-          prom = true;
-        } else if (!pcf->isWhite() && pcf->getRow() == 6) { // black
-          pcf = new Queen(0, pcf->getRow(), pcf->getCol());
-          move.append("=Q");
-          prom = true;
-        }
-      } // end promotion
-
-
-      // make move
-      board[to.first][to.second] = pcf;
-      pcf->makeMove(to.first, to.second);
-      board[from.first][from.second] = nullptr;
-      if (check(board, player)) { // gives itself check
-        info = "observe check";
-        // reset move
-        board[to.first][to.second] = pct;
-        if (prom) { // promotion
-          pcf = new Pawn(pcf->isWhite(), pcf->getRow(), pcf->getCol());
-        }
-        board[from.first][from.second] = pcf;
-        pcf->makeMove(from.first, from.second);
-        if (cap) captured.pop_back();
-        return false;
-      } else if (check(board, !player)) { // gives opponent check
-        if (resolveCheck(board, !player)) {
-          move.append(1, '+');
-          checked = true;
-        } else { // cannot get out of check
-          move.append(1, '#');
-          moves.push_back(move);
-          checkmate = to;
-          mvCount++;
-          return true;
-        }
+      if (pcf->getType() == 'P') {
+        // en passant
+        if (!pct && from.second != to.second) flags = EP_CAPTURE;
+        if (abs(to.first - from.first) == 2) flags = DOUBLE_PUSH;
+        // promotion
+        if (to.first == 0 || to.first == 7) flags |= PROMOTION | (QUEEN - KNIGHT);
       }
-      // complete move
-      moves.push_back(move);
-      player = !player;
-      mvCount++;
-      return true;
-
-    // illegal move
-    } else {
-      info = "illegal move";
+      move = encodeMove(sqf, sqt, flags);
+    }
+
+    // make move
+    doMove(move);
+    if (check(*this, !player)) { // gives itself check
+      info = "observe check";
+      undoMove();
       return false;
+    } else if (checkers) { // gives opponent check
+      if (resolveCheck(*this, player)) {
+        checked = true;
+      } else { // cannot get out of check
+        checkmate = to;
+      }
     }
+    return true;
   }
 
-  // gamestate: 0 = game over, 1 = 2-player, 2 = analyze 
+  // gamestate: 0 = game over, 1 = 2-player, 2 = analyze
   short gamestate;
 
   // player on turn, starting with white
   bool player;
-  
-  // matrix of pieces representing the board
-  vector<vector<Piece*>> board;
 
-  // vector of moves, used as a stack
-  vector<string> moves;
+  // bitboards of pieces, indexed by color and piece type
+  Bitboard pieces[2][6];
+
+  // bitboards of all pieces of one color
+  Bitboard colors[2];
+
+  // bitboard of all pieces on the board
+  Bitboard occupied;
+
+  // piece on each square, indexed by square
+  Piece* squares[64];
+
+  // storage of the pieces on the board and the captured ones
+  PiecePool pool;
+
+  // square of the king, indexed by color
+  int kingSquare[2];
+
+  // pieces giving check to the player on turn
+  Bitboard checkers;
+
+  // hash key of pieces, player on turn, castling rights and en passant file
+  uint64_t key;
+
+  // sum of the piece square scores, kept up to date by putPiece and removePiece
+  Score psq;
 
-  // list of captured pieces, used as a stack
-  vector<Piece*> captured;
+  // game phase from the pieces on the board, MAX_PHASE at the start
+  int phase;
+
+  // first layer of the network, updated with the pieces if one is loaded,
+  // and brought up to date by the evaluation after king moves
+  mutable Accumulator acc;
+
+  // castling rights as bit mask of CastlingRight
+  short castlingRights;
+
+  // square behind a pawn that just made a double step, if it can be captured
+  int epSquare;
+
+  // half moves since the last capture or pawn move
+  int halfmoveClock;
+
+  // moves made, used as a stack
+  vector<Move> moves;
+
+  // state before each move, parallel to moves
+  vector<State> states;
 
   // total count of moves
   int mvCount;
-  
-  // castled: 0 = no, 1 = white, 2 = black, 3 = both
-  short castled;
-  
+
+  // half moves played before the position was set up, from the FEN
+  int startPly;
+
   // coordinates of the piece, which gave checkmate
   std::pair<int, int> checkmate;
-  
+
   // last move gave check
   bool checked;
 
@@ -693,5 +421,15 @@ public:
 
   // infotext
   string info;
+
+  // table to prefetch the entry of each new position from, if any
+  const TranspositionTable* tt;
+
+private:
+  // the pieces belong to the pool of a position, so a plain copy would
+  // point into another pool; copyPosition clones them instead
+  Position(const Position&) = delete;
+  Position& operator=(const Position&) = default;
+  friend void copyPosition(Position& dst, const Position& src);
 }; // end Position
 
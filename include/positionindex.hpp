@@ -0,0 +1,86 @@
+#pragma once
+
+#include "gamestore.hpp"
+#include "mappedfile.hpp"
+#include "move.hpp"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Positions of a game store sorted by hash key, in little endian byte order:
+//   header:  "TCPI", uint32 version, uint64 entry count, uint64 game count
+//            of the store, 8 bytes reserved
+//   entries: uint64 key, uint32 game, uint16 move, uint8 result, uint8
+//            reserved, for every position in which a move was played
+// The entries are sorted by key, then game and move, so all games of a
+// position are found together with a binary search.
+const uint32_t POSITION_INDEX_VERSION = 1;
+const size_t POSITION_INDEX_HEADER = 32;
+const size_t POSITION_INDEX_ENTRY = 16;
+
+// a position of a game and the move played in it
+struct IndexEntry {
+  uint64_t key;
+  uint32_t game;
+  Move move;
+  // GameResult of the game
+  uint8_t result;
+};
+
+// how often a move was played in a position and how the games ended
+struct MoveStats {
+  Move move = NO_MOVE;
+  uint64_t games = 0;
+  uint64_t white = 0;
+  uint64_t draws = 0;
+  uint64_t black = 0;
+};
+
+// counts of an index build
+struct IndexStats {
+  uint64_t games = 0;
+  // games left out because a record or a move is damaged
+  uint64_t damaged = 0;
+  uint64_t entries = 0;
+  // sorted runs written to disk before the merge
+  uint64_t runs = 0;
+};
+
+// build the index of a game store with the given number of threads. Every
+// thread replays games and sorts its entries into runs of at most the
+// given memory, so the memory used grows with the threads. The runs are
+// merged a bounded number at a time, in passes, into the index. Fails if
+// a file cannot be written.
+bool buildPositionIndex(const GameStore& store, const string& path, int threads,
+                        size_t memory, IndexStats& stats);
+
+// read access to a position index; the file is mapped into memory
+class PositionIndex {
+public:
+  // open an index, fails if it is missing or damaged
+  bool open(const string& path);
+
+  // number of entries
+  uint64_t size() const { return count; }
+
+  // number of games of the store the index was built from
+  uint64_t games() const { return storeGames; }
+
+  // entry i, counted from 0
+  IndexEntry entry(uint64_t i) const;
+
+  // first entry of the position and the end of its entries
+  pair<uint64_t, uint64_t> find(uint64_t key) const;
+
+  // moves played in the position, the most frequent first
+  vector<MoveStats> moveStats(uint64_t key) const;
+
+private:
+  MappedFile file;
+  uint64_t count = 0;
+  uint64_t storeGames = 0;
+  const unsigned char* entries = nullptr;
+};
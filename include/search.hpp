@@ -0,0 +1,131 @@
+#pragma once
+
+#include "movegen.hpp"
+#include "position.hpp"
+#include "tt.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+using namespace std;
+
+// maximum depth of the search tree
+const int MAX_PLY = 64;
+
+// score of being mated at the root, mates further away score less
+const int MATE = 32000;
+
+// scores beyond this bound are mates
+const int MATE_BOUND = MATE - MAX_PLY;
+
+// larger than any score
+const int INFINITE = 32001;
+
+// when to stop searching, zero means no limit
+struct SearchLimits {
+  int depth = MAX_PLY;
+  uint64_t nodes = 0;
+  int64_t movetime = 0; // milliseconds
+};
+
+// outcome of a search, from the view of the player on turn
+struct SearchResult {
+  Move bestMove = NO_MOVE;
+  int score = 0;
+  int depth = 0;
+  uint64_t nodes = 0;
+  int64_t time = 0; // milliseconds
+  vector<Move> pv;
+  // effective branching factor: nodes of the last iteration divided by
+  // the nodes of the one before, lower means better move ordering
+  double branching = 0;
+};
+
+// negamax alpha-beta search with iterative deepening; with more than one
+// thread, helpers search copies of the position at the same time and share
+// their results through the table (Lazy SMP). Every thread's state sits in
+// its own cache lines, so the threads do not slow each other down.
+class alignas(64) Search {
+public:
+  Search(Position& pos, TranspositionTable* tt = nullptr, int id = 0)
+    : pos{pos}, tt{tt}, id{id} {}
+
+  // search the position within the limits and return the best line
+  SearchResult run(const SearchLimits& limits);
+
+  // called after every completed iteration of the main thread
+  function<void(const SearchResult&)> report;
+
+  // set from another thread to end the search early
+  atomic<bool> stop{false};
+
+  // flag of the owner which ends the search as well, e.g. when the
+  // position searched is outdated
+  const atomic<bool>* abort = nullptr;
+
+  // number of threads searching, the helpers need the table to be useful
+  int threads = 1;
+
+private:
+  // deepen the search iteration by iteration until a limit is reached
+  SearchResult iterate();
+
+  // score of a position after the captures settled down
+  int quiesce(int depth, int ply, int alpha, int beta);
+
+  // score of the position searched to the given depth
+  int negamax(int depth, int ply, int alpha, int beta);
+
+  // remember a quiet move which caused a cutoff
+  void updateQuietStats(Move move, int ply, int depth,
+                        const Move* quiets, int quietCount);
+
+  // test wether the position is drawn by repetition or the 50 moves rule
+  bool isDraw() const;
+
+  // test the node and time limits, sets stopped when exceeded
+  void checkLimits();
+
+  // milliseconds since the search started
+  int64_t elapsed() const;
+
+  // the position searched, restored when the search ends
+  Position& pos;
+
+  // shared table of earlier results, if any
+  TranspositionTable* tt;
+
+  // 0 for the main thread, which decides when to stop, else a helper
+  int id;
+
+  // limits of the current search
+  SearchLimits limits;
+
+  // time the search started
+  chrono::steady_clock::time_point start;
+
+  // positions visited
+  uint64_t nodes = 0;
+
+  // the search ran out of time or nodes, or was stopped
+  bool stopped = false;
+
+  // triangular table of principal variations, one line per ply
+  Move pvTable[MAX_PLY + 1][MAX_PLY + 1];
+  int pvLength[MAX_PLY + 1];
+
+  // two quiet moves per ply which recently caused a cutoff
+  Move killers[MAX_PLY + 1][2];
+
+  // success of quiet moves, indexed by color, from and to square
+  int history[2][64][64];
+
+  // quiet move which refuted a move, indexed by its from and to square
+  Move counterMoves[64][64];
+};
+
+// search the position within the limits, using the table if given
+SearchResult search(Position& pos, const SearchLimits& limits,
+                    TranspositionTable* tt = nullptr, int threads = 1);
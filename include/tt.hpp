@@ -0,0 +1,90 @@
+#pragma once
+
+#include "move.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#ifdef _MSC_VER
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+
+// how the stored score relates to the true score
+enum Bound { BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT };
+
+// unpacked content of a table entry
+struct TTData {
+  Move move;
+  int score;
+  int depth;
+  Bound bound;
+};
+
+// one entry of 16 bytes: the data word packs the move (16 bits), the
+// score (16), the depth (8), the bound (2) and the age (6); the check word
+// holds the key xor the data, so an entry torn by concurrent writes fails
+// the check and reads as a miss instead of returning wrong data
+struct TTEntry {
+  atomic<uint64_t> check;
+  atomic<uint64_t> data;
+};
+
+// number of entries in one bucket, four entries fill a cache line
+const int BUCKET_SIZE = 4;
+
+// entries probed together, aligned so one probe touches one cache line
+struct alignas(64) TTBucket {
+  TTEntry entries[BUCKET_SIZE];
+};
+
+// hash table of search results, shared by all search threads without locks
+class TranspositionTable {
+public:
+  // allocate a table of the given size in MB, rounded down to a power of two
+  void resize(size_t mb);
+
+  // empty all entries, using several threads for large tables
+  void clear(int threads = 1);
+
+  // start a new search, older entries are replaced first from now on
+  void newSearch() { age = (age + 1) & 63; }
+
+  // look up a position, returns false if it is not stored
+  bool probe(uint64_t key, TTData& tte) const;
+
+  // store a search result, preferring to replace shallow and old entries
+  void store(uint64_t key, int depth, Bound bound, int score, Move move);
+
+  // load the bucket of a position into the cache ahead of the probe
+  void prefetch(uint64_t key) const {
+    if (buckets.empty()) return;
+#ifdef _MSC_VER
+    _mm_prefetch((const char*)&bucket(key), _MM_HINT_T0);
+#else
+    __builtin_prefetch(&bucket(key));
+#endif
+  }
+
+  // permill of entries used by the current search, sampled
+  int hashfull() const;
+
+  // size of the table in MB
+  size_t sizeMB() const { return buckets.size() * sizeof(TTBucket) >> 20; }
+
+private:
+  // bucket of a position, the low bits of the key select it
+  const TTBucket& bucket(uint64_t key) const {
+    return buckets[key & (buckets.size() - 1)];
+  }
+  TTBucket& bucket(uint64_t key) {
+    return buckets[key & (buckets.size() - 1)];
+  }
+
+  // the buckets, a power of two of them
+  vector<TTBucket> buckets;
+
+  // age of the current search, stored in the entries
+  uint8_t age = 0;
+};
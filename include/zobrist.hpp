@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+using namespace std;
+
+// random keys for hashing positions, indexed by color, piece type and square
+extern uint64_t zobristPiece[2][6][64];
+
+// key for black on turn
+extern uint64_t zobristSide;
+
+// keys for each combination of castling rights
+extern uint64_t zobristCastling[16];
+
+// keys for the file of the en passant square
+extern uint64_t zobristEp[8];
+
+// fill the keys with fixed pseudo random numbers
+void initZobrist();